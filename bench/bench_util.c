@@ -0,0 +1,21 @@
+#include "bench_util.h"
+#include <glib/gstdio.h>
+
+void bench_remove_dir(const char *path) {
+    GDir *dir = g_dir_open(path, 0, NULL);
+    if (dir) {
+        const char *name;
+        while ((name = g_dir_read_name(dir))) {
+            char *file = g_build_filename(path, name, NULL);
+            g_remove(file);
+            g_free(file);
+        }
+        g_dir_close(dir);
+    }
+    g_rmdir(path);
+}
+
+int bench_compare_double(const void *a, const void *b) {
+    double x = *(const double *)a, y = *(const double *)b;
+    return x < y ? -1 : x > y;
+}
@@ -0,0 +1,14 @@
+#ifndef BENCH_UTIL_H
+#define BENCH_UTIL_H
+
+#include <glib.h>
+
+/* Helpers shared by the benchmarks. */
+
+/* Delete a flat directory (such as a bench cache) and the files in it. */
+void bench_remove_dir(const char *path);
+
+/* qsort comparator for doubles, ascending */
+int  bench_compare_double(const void *a, const void *b);
+
+#endif /* BENCH_UTIL_H */
@@ -0,0 +1,108 @@
+/*
+ * Chapter download benchmark: pull a chapter's worth of pages into an
+ * empty cache through the HTTP layer, over HTTP/1.1 connections and then
+ * multiplexed over HTTP/2, and report the wall time of each.
+ *
+ *   bench-chapter-download <base-url> [pages] [rounds] [ca-file]
+ *
+ * Pages are fetched as <base-url>/page-NNN.jpg, the way bench/serve-pages.sh
+ * lays them out.
+ */
+#include "bench_util.h"
+#include "net/http.h"
+#include "net/rate_limiter.h"
+#include "util/cache.h"
+#include <stdio.h>
+#include <stdlib.h>
+
+typedef struct {
+    GMainLoop *loop;
+    int        pending;
+    int        failed;
+} Run;
+
+static void on_page_done(HttpResponse *resp, gpointer user_data) {
+    Run *run = user_data;
+    if (!resp || resp->status_code != 200) run->failed++;
+    http_response_free(resp);
+    if (--run->pending == 0) g_main_loop_quit(run->loop);
+}
+
+/* One cold download of the whole chapter; returns seconds, or -1 */
+static double download_chapter(const char *base_url, int pages,
+                               gboolean multiplex) {
+    char *dir = g_dir_make_tmp("bench-cache-XXXXXX", NULL);
+    if (!dir) return -1;
+    cache_init(dir);
+    /* Start every round cold, and keep the user's TLS sessions out of it */
+    http_set_state_dir(dir);
+
+    http_set_multiplex(multiplex);
+    http_global_init();
+
+    Run run = { g_main_loop_new(NULL, FALSE), pages, 0 };
+    gint64 start = g_get_monotonic_time();
+
+    for (int i = 0; i < pages; i++) {
+        char *url = g_strdup_printf("%s/page-%03d.jpg", base_url, i);
+        char *key = cache_key_from_url(url);
+        http_fetch_to_cache_async(url, key,
+                                  i == 0 ? HTTP_PRIORITY_USER_BLOCKING
+                                         : HTTP_PRIORITY_SPECULATIVE,
+                                  on_page_done, &run, NULL);
+        g_free(key);
+        g_free(url);
+    }
+    g_main_loop_run(run.loop);
+    double secs = (g_get_monotonic_time() - start) / (double)G_USEC_PER_SEC;
+
+    g_main_loop_unref(run.loop);
+    http_global_cleanup();
+    cache_shutdown();
+    bench_remove_dir(dir);
+    g_free(dir);
+
+    if (run.failed) {
+        fprintf(stderr, "%d of %d pages failed\n", run.failed, pages);
+        return -1;
+    }
+    return secs;
+}
+
+static void report(const char *label, const char *base_url, int pages,
+                   int rounds, gboolean multiplex) {
+    double *times = g_new(double, rounds);
+    for (int r = 0; r < rounds; r++) {
+        times[r] = download_chapter(base_url, pages, multiplex);
+        if (times[r] < 0) {
+            printf("%-22s failed\n", label);
+            g_free(times);
+            return;
+        }
+    }
+    qsort(times, rounds, sizeof(double), bench_compare_double);
+    printf("%-22s median %6.3f s   best %6.3f s   worst %6.3f s\n",
+           label, times[rounds / 2], times[0], times[rounds - 1]);
+    g_free(times);
+}
+
+int main(int argc, char *argv[]) {
+    if (argc < 2) {
+        fprintf(stderr, "usage: %s <base-url> [pages] [rounds] [ca-file]\n",
+                argv[0]);
+        return 2;
+    }
+    const char *base_url = argv[1];
+    int pages = argc > 2 ? atoi(argv[2]) : 40;
+    int rounds = argc > 3 ? atoi(argv[3]) : 5;
+    if (argc > 4) http_set_ca_file(argv[4]);
+    if (pages < 1 || rounds < 1) return 2;
+
+    /* Measure the transport, not the politeness limit towards the source */
+    rate_limiter_configure(RATE_LIMITER_DEFAULT_PER_HOST, 0, 1);
+
+    printf("%d pages from %s, %d rounds\n", pages, base_url, rounds);
+    report("HTTP/1.1 connections", base_url, pages, rounds, FALSE);
+    report("HTTP/2 multiplexed", base_url, pages, rounds, TRUE);
+    return 0;
+}
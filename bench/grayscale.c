@@ -0,0 +1,195 @@
+/*
+ * Grayscale benchmark: convert a synthetic full-screen page the way
+ * image_loader_to_grayscale used to (copy the pixbuf, then a double
+ * multiply per channel) and with grayscale_row, with and without a tone
+ * curve, and report the time per page. First every kernel this CPU can
+ * run is checked against a plain reference on odd widths and tails; a
+ * mismatch fails the run.
+ *
+ *   bench-grayscale [width] [height] [rounds]
+ */
+#include "bench_util.h"
+#include "util/grayscale.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* The old per-pixel loop, on raw buffers instead of pixbufs */
+static void legacy_grayscale(const guchar *src, guchar *dst, int width,
+                             int height, int rowstride, int n_channels,
+                             gboolean has_alpha) {
+    memcpy(dst, src, (size_t)rowstride * height);
+    for (int y = 0; y < height; y++) {
+        const guchar *src_row = src + y * rowstride;
+        guchar *dst_row = dst + y * rowstride;
+        for (int x = 0; x < width; x++) {
+            int offset = x * n_channels;
+            guchar r = src_row[offset];
+            guchar g = src_row[offset + 1];
+            guchar b = src_row[offset + 2];
+            guchar gray = (guchar)(0.299 * r + 0.587 * g + 0.114 * b);
+            dst_row[offset] = gray;
+            dst_row[offset + 1] = gray;
+            dst_row[offset + 2] = gray;
+            if (has_alpha)
+                dst_row[offset + 3] = src_row[offset + 3];
+        }
+    }
+}
+
+/* What every kernel must produce, one pixel at a time */
+static void reference_row(const guint8 *src, int src_channels, guint8 *dst,
+                          int dst_channels, int width, const guint8 *lut) {
+    for (int x = 0; x < width; x++) {
+        const guint8 *s = src + x * src_channels;
+        guint8 *d = dst + x * dst_channels;
+        guint8 y = (guint8)((77 * s[0] + 150 * s[1] + 29 * s[2] + 128) >> 8);
+        if (lut) y = lut[y];
+        for (int c = 0; c < MIN(dst_channels, 3); c++)
+            d[c] = y;
+        if (dst_channels == 4)
+            d[3] = src_channels == 4 ? s[3] : 255;
+    }
+}
+
+/* Every width up to a few vectors past the widest kernel, so each tail
+ * length is hit, with canary bytes after the row to catch overruns */
+#define CHECK_WIDTH  67
+#define CHECK_CANARY 16
+
+static int check_kernels(const guint8 *lut) {
+    static const int src_channels[] = { 3, 4 };
+    static const int dst_channels[] = { 1, 3, 4 };
+    guint8 src[CHECK_WIDTH * 4];
+    guint8 want[CHECK_WIDTH * 4 + CHECK_CANARY];
+    guint8 got[CHECK_WIDTH * 4 + CHECK_CANARY];
+    GRand *rand = g_rand_new_with_seed(7);
+    int failures = 0;
+
+    for (size_t i = 0; i < sizeof(src); i++)
+        src[i] = (guint8)g_rand_int_range(rand, 0, 256);
+    g_rand_free(rand);
+
+    for (const char *const *k = grayscale_kernels(); *k; k++) {
+        int before = failures;
+        for (guint si = 0; si < G_N_ELEMENTS(src_channels); si++)
+        for (guint di = 0; di < G_N_ELEMENTS(dst_channels); di++)
+        for (int with_lut = 0; with_lut < 2; with_lut++)
+        for (int width = 1; width <= CHECK_WIDTH; width++) {
+            int sc = src_channels[si], dc = dst_channels[di];
+            const guint8 *l = with_lut ? lut : NULL;
+            size_t bytes = (size_t)width * dc;
+
+            memset(want, 0xa5, sizeof(want));
+            memset(got, 0xa5, sizeof(got));
+            reference_row(src, sc, want, dc, width, l);
+            grayscale_row_kernel(*k, src, sc, got, dc, width, l);
+            if (memcmp(want, got, bytes + CHECK_CANARY) != 0) {
+                fprintf(stderr, "%s kernel: %d -> %d channels%s, width %d "
+                        "differs from the reference\n", *k, sc, dc,
+                        l ? " + LUT" : "", width);
+                failures++;
+            }
+        }
+        if (failures == before)
+            printf("%s kernel matches the reference\n", *k);
+    }
+    return failures;
+}
+
+typedef struct {
+    const guint8 *src;
+    int           width;
+    int           height;
+    int           rowstride;
+    guint8       *dst;
+    int           dst_channels;
+    const guint8 *lut;
+} Page;
+
+static void kernel_page(const Page *p) {
+    int dst_stride = p->width * p->dst_channels;
+    for (int y = 0; y < p->height; y++)
+        grayscale_row(p->src + y * p->rowstride, 3,
+                      p->dst + y * dst_stride, p->dst_channels,
+                      p->width, p->lut);
+}
+
+static void report(const char *label, double *times, int rounds) {
+    qsort(times, rounds, sizeof(double), bench_compare_double);
+    printf("%-26s median %7.2f ms   best %7.2f ms\n", label,
+           times[rounds / 2] * 1000, times[0] * 1000);
+}
+
+#define TIME(times, r, stmt) do {                                        \
+        gint64 start_ = g_get_monotonic_time();                          \
+        stmt;                                                            \
+        times[r] = (g_get_monotonic_time() - start_) /                   \
+                   (double)G_USEC_PER_SEC;                               \
+    } while (0)
+
+int main(int argc, char *argv[]) {
+    int width = argc > 1 ? atoi(argv[1]) : 1072;
+    int height = argc > 2 ? atoi(argv[2]) : 1448;
+    int rounds = argc > 3 ? atoi(argv[3]) : 20;
+    if (width < 1 || height < 1 || rounds < 1) {
+        fprintf(stderr, "usage: %s [width] [height] [rounds]\n", argv[0]);
+        return 2;
+    }
+
+    guint8 lut[256];
+    grayscale_tone_lut(lut, 1.4, 1.2);
+    if (check_kernels(lut) > 0)
+        return 1;
+
+    /* Pixbuf rows are padded to four bytes */
+    int rowstride = (width * 3 + 3) & ~3;
+    size_t size = (size_t)rowstride * height;
+    guint8 *src = g_malloc(size);
+    GRand *rand = g_rand_new_with_seed(42);
+    for (size_t i = 0; i < size; i++)
+        src[i] = (guint8)g_rand_int_range(rand, 0, 256);
+    g_rand_free(rand);
+
+    guint8 *legacy = g_malloc(size);
+    guint8 *rgb = g_malloc((size_t)width * 3 * height);
+    guint8 *gray = g_malloc((size_t)width * height);
+
+    Page to_rgb = { src, width, height, rowstride, rgb, 3, NULL };
+    Page to_rgb_lut = { src, width, height, rowstride, rgb, 3, lut };
+    Page to_gray = { src, width, height, rowstride, gray, 1, NULL };
+
+    /* Integer weights and rounding may differ from the doubles by one */
+    legacy_grayscale(src, legacy, width, height, rowstride, 3, FALSE);
+    kernel_page(&to_rgb);
+    int worst = 0;
+    for (int y = 0; y < height; y++)
+        for (int x = 0; x < width * 3; x++)
+            worst = MAX(worst, ABS(legacy[y * rowstride + x] -
+                                   rgb[y * width * 3 + x]));
+
+    double *times = g_new(double, rounds);
+    printf("%dx%d RGB page, %d rounds, max difference %d\n",
+           width, height, rounds, worst);
+
+    for (int r = 0; r < rounds; r++)
+        TIME(times, r, legacy_grayscale(src, legacy, width, height,
+                                        rowstride, 3, FALSE));
+    report("copy + double (old)", times, rounds);
+
+    for (int r = 0; r < rounds; r++) TIME(times, r, kernel_page(&to_rgb));
+    report("grayscale_row RGB", times, rounds);
+
+    for (int r = 0; r < rounds; r++) TIME(times, r, kernel_page(&to_rgb_lut));
+    report("grayscale_row RGB + LUT", times, rounds);
+
+    for (int r = 0; r < rounds; r++) TIME(times, r, kernel_page(&to_gray));
+    report("grayscale_row gray", times, rounds);
+
+    g_free(times);
+    g_free(gray);
+    g_free(rgb);
+    g_free(legacy);
+    g_free(src);
+    return 0;
+}
@@ -0,0 +1,107 @@
+/*
+ * Image download benchmark: pull one big page image into an empty cache
+ * the way the reader does when the user opens it, as a single stream and
+ * then split into parallel byte ranges, and report the wall time of each.
+ *
+ *   bench-image-download <image-url> [rounds] [ca-file] [parts]
+ *
+ * Serve a big image with bench/serve-pages.sh, e.g. one 6 MB page with
+ * each response held to 256 KB/s: serve-pages.sh 1 6000 80 256
+ */
+#include "bench_util.h"
+#include "net/http.h"
+#include "net/rate_limiter.h"
+#include "util/cache.h"
+#include <stdio.h>
+#include <stdlib.h>
+
+typedef struct {
+    GMainLoop *loop;
+    gboolean   ok;
+    size_t     size;
+} Run;
+
+static void on_image_done(HttpResponse *resp, gpointer user_data) {
+    Run *run = user_data;
+    run->ok = resp && resp->status_code == 200;
+    run->size = resp ? resp->size : 0;
+    http_response_free(resp);
+    g_main_loop_quit(run->loop);
+}
+
+/* One cold download of the image; returns seconds, or -1 */
+static double download_image(const char *url, guint parts, size_t *size) {
+    char *dir = g_dir_make_tmp("bench-cache-XXXXXX", NULL);
+    if (!dir) return -1;
+    cache_init(dir);
+    /* Start every round cold, and keep the user's TLS sessions out of it */
+    http_set_state_dir(dir);
+
+    http_set_split(parts);
+    http_global_init();
+
+    Run run = { g_main_loop_new(NULL, FALSE), FALSE, 0 };
+    gint64 start = g_get_monotonic_time();
+
+    char *key = cache_key_from_url(url);
+    http_fetch_to_cache_async(url, key, HTTP_PRIORITY_USER_BLOCKING,
+                              on_image_done, &run, NULL);
+    g_free(key);
+    g_main_loop_run(run.loop);
+    double secs = (g_get_monotonic_time() - start) / (double)G_USEC_PER_SEC;
+
+    g_main_loop_unref(run.loop);
+    http_global_cleanup();
+    cache_shutdown();
+    bench_remove_dir(dir);
+    g_free(dir);
+
+    if (!run.ok) {
+        fprintf(stderr, "download failed\n");
+        return -1;
+    }
+    *size = run.size;
+    return secs;
+}
+
+static void report(const char *label, const char *url, int rounds,
+                   guint parts) {
+    double *times = g_new(double, rounds);
+    size_t size = 0;
+    for (int r = 0; r < rounds; r++) {
+        times[r] = download_image(url, parts, &size);
+        if (times[r] < 0) {
+            printf("%-22s failed\n", label);
+            g_free(times);
+            return;
+        }
+    }
+    qsort(times, rounds, sizeof(double), bench_compare_double);
+    printf("%-22s median %6.3f s   best %6.3f s   worst %6.3f s   "
+           "(%zu KB)\n", label, times[rounds / 2], times[0],
+           times[rounds - 1], size / 1024);
+    g_free(times);
+}
+
+int main(int argc, char *argv[]) {
+    if (argc < 2) {
+        fprintf(stderr, "usage: %s <image-url> [rounds] [ca-file] [parts]\n",
+                argv[0]);
+        return 2;
+    }
+    const char *url = argv[1];
+    int rounds = argc > 2 ? atoi(argv[2]) : 5;
+    if (argc > 3 && argv[3][0]) http_set_ca_file(argv[3]);
+    int parts = argc > 4 ? atoi(argv[4]) : 4;
+    if (rounds < 1 || parts < 2) return 2;
+
+    /* Measure the transport, not the politeness limit towards the source */
+    rate_limiter_configure(RATE_LIMITER_DEFAULT_PER_HOST, 0, 1);
+
+    char *label = g_strdup_printf("%d parallel ranges", parts);
+    printf("%s, %d rounds\n", url, rounds);
+    report("single stream", url, rounds, 1);
+    report(label, url, rounds, (guint)parts);
+    g_free(label);
+    return 0;
+}
@@ -0,0 +1,100 @@
+#!/usr/bin/env bash
+# Local stand-in for a manga CDN, for bench-chapter-download.
+#
+# Serves <pages> random "page-NNN.jpg" files of <kb> KB each from
+# https://localhost:8443/ through nghttpx, which speaks both HTTP/1.1 and
+# HTTP/2, in front of a plain backend that adds <delay-ms> to every
+# response to mimic a distant server. Byte ranges are served, and each
+# response can be held to <stream-kbps> KB/s, like one TCP stream on a
+# lossy long-distance path (0 = unlimited).
+#
+#   bench/serve-pages.sh [pages] [kb] [delay-ms] [stream-kbps]
+#
+# Requires nghttpx (nghttp2), openssl and python3. The certificate to
+# pass to the benchmark is printed on startup.
+set -euo pipefail
+
+PAGES=${1:-40}
+KB=${2:-300}
+DELAY_MS=${3:-80}
+STREAM_KBPS=${4:-0}
+FRONT_PORT=8443
+BACK_PORT=8480
+
+WORK=$(mktemp -d)
+trap 'kill $(jobs -p) 2>/dev/null; rm -rf "$WORK"' EXIT
+
+mkdir -p "$WORK/htdocs"
+for i in $(seq 0 $((PAGES - 1))); do
+  head -c $((KB * 1024)) /dev/urandom > "$WORK/htdocs/$(printf 'page-%03d.jpg' "$i")"
+done
+
+openssl req -x509 -newkey rsa:2048 -nodes -days 1 -subj "/CN=localhost" \
+  -addext "subjectAltName=DNS:localhost" \
+  -keyout "$WORK/key.pem" -out "$WORK/cert.pem" 2>/dev/null
+
+python3 - "$WORK/htdocs" "$BACK_PORT" "$DELAY_MS" "$STREAM_KBPS" <<'EOF' &
+import functools, http.server, os, re, socketserver, sys, time
+root, port, delay = sys.argv[1], int(sys.argv[2]), int(sys.argv[3]) / 1000.0
+rate = int(sys.argv[4]) * 1024
+
+class Handler(http.server.SimpleHTTPRequestHandler):
+    protocol_version = "HTTP/1.1"
+    def do_GET(self):
+        time.sleep(delay)
+        path = self.translate_path(self.path)
+        if not os.path.isfile(path):
+            return super().do_GET()
+        size = os.path.getsize(path)
+        etag = '"%x-%x"' % (int(os.path.getmtime(path)), size)
+        first, last = 0, size - 1
+        m = re.fullmatch(r"bytes=(\d+)-(\d*)", self.headers.get("Range", ""))
+        partial = m is not None and self.headers.get("If-Range", etag) == etag
+        if partial:
+            first = int(m.group(1))
+            last = min(int(m.group(2) or size - 1), size - 1)
+            if first > last:
+                self.send_response(416)
+                self.send_header("Content-Range", "bytes */%d" % size)
+                self.send_header("Content-Length", "0")
+                self.end_headers()
+                return
+        self.send_response(206 if partial else 200)
+        self.send_header("Content-Type", self.guess_type(path))
+        self.send_header("Content-Length", str(last - first + 1))
+        self.send_header("Accept-Ranges", "bytes")
+        self.send_header("ETag", etag)
+        if partial:
+            self.send_header("Content-Range",
+                             "bytes %d-%d/%d" % (first, last, size))
+        self.end_headers()
+        try:
+            with open(path, "rb") as f:
+                f.seek(first)
+                left, sent, start = last - first + 1, 0, time.monotonic()
+                while left > 0:
+                    data = f.read(min(16384, left))
+                    self.wfile.write(data)
+                    sent += len(data)
+                    left -= len(data)
+                    ahead = sent / rate - (time.monotonic() - start) if rate else 0
+                    if ahead > 0:
+                        time.sleep(ahead)
+        except (BrokenPipeError, ConnectionResetError):
+            pass    # the client had what it wanted
+    def log_message(self, *args):
+        pass
+
+class Server(socketserver.ThreadingMixIn, http.server.HTTPServer):
+    daemon_threads = True
+
+Server(("127.0.0.1", port),
+       functools.partial(Handler, directory=root)).serve_forever()
+EOF
+
+echo "CA file: $WORK/cert.pem"
+echo "Run:     bench-chapter-download https://localhost:$FRONT_PORT $PAGES 5 $WORK/cert.pem"
+echo "    or:  bench-image-download https://localhost:$FRONT_PORT/page-000.jpg 5 $WORK/cert.pem"
+nghttpx --frontend="*,$FRONT_PORT" --backend="127.0.0.1,$BACK_PORT" \
+  --workers=2 --no-ocsp --errorlog-file=/dev/stderr \
+  "$WORK/key.pem" "$WORK/cert.pem"
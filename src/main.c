@@ -1,8 +1,14 @@
 #include <gtk/gtk.h>
+#include <glib-unix.h>
+#include <signal.h>
 #include <string.h>
 #include "app.h"
 #include "device/brightness.h"
 #include "net/http.h"
+#include "net/image_loader.h"
+#include "net/net_shaper.h"
+#include "net/net_timing.h"
+#include "net/rate_limiter.h"
 #include "util/cache.h"
 #include "util/database.h"
 #include "ui/widgets.h"
@@ -10,6 +16,67 @@
 #include "sources/mangakatana.h"
 #include "updater.h"
 
+/* Read a numeric setting, falling back to def when unset or invalid */
+static gdouble setting_number(const char *key, gdouble def) {
+    char *val = db_get_setting(key);
+    gdouble num = def;
+    if (val) {
+        char *end = NULL;
+        gdouble parsed = g_ascii_strtod(val, &end);
+        if (end != val && parsed >= 0) num = parsed;
+        g_free(val);
+    }
+    return num;
+}
+
+/* Request limits can be tuned per source through the settings table */
+static void configure_rate_limits(void) {
+    rate_limiter_configure(
+        (guint)setting_number("net_max_per_host", RATE_LIMITER_DEFAULT_PER_HOST),
+        setting_number("net_requests_per_sec", RATE_LIMITER_DEFAULT_RATE),
+        (guint)setting_number("net_burst", RATE_LIMITER_DEFAULT_BURST));
+}
+
+/* Page tone for the e-ink panel; page_gamma > 1 darkens faint scans */
+static void configure_page_tone(void) {
+    image_loader_set_tone(setting_number("page_gamma", 1.0),
+                          setting_number("page_contrast", 1.0));
+}
+
+/* Offline sessions for testing and benchmarks:
+ *   MANGA_READER_RECORD=<dir>  save every response as a fixture
+ *   MANGA_READER_REPLAY=<dir>  serve those fixtures, no network needed;
+ *     with MANGA_READER_REPLAY_LATENCY=1 each takes as long as it did */
+static void configure_transport(void) {
+    const char *record = g_getenv("MANGA_READER_RECORD");
+    const char *replay = g_getenv("MANGA_READER_REPLAY");
+    if (replay && *replay) {
+        http_set_transport(HTTP_TRANSPORT_REPLAY, replay,
+                           g_strcmp0(g_getenv("MANGA_READER_REPLAY_LATENCY"),
+                                     "1") == 0);
+    } else if (record && *record) {
+        http_set_transport(HTTP_TRANSPORT_RECORD, record, FALSE);
+    }
+}
+
+/* Emulate a poor link for testing, e.g. MANGA_READER_NETEM="rtt=400,bw=48k"
+ * (see net_shaper.h); the net_emulate setting works the same way */
+static void configure_network_emulation(void) {
+    const char *env = g_getenv("MANGA_READER_NETEM");
+    char *spec = env ? g_strdup(env) : db_get_setting("net_emulate");
+    if (spec && *spec) net_shaper_configure(spec);
+    g_free(spec);
+}
+
+/* kill -USR1 <pid> dumps recent request timings without touching the UI */
+static gboolean on_dump_timings(gpointer user_data) {
+    (void)user_data;
+    char *path = net_timing_save();
+    if (path) g_message("Network timings saved to %s", path);
+    g_free(path);
+    return TRUE;
+}
+
 int main(int argc, char *argv[]) {
     gtk_init(&argc, &argv);
 
@@ -17,6 +84,7 @@ int main(int argc, char *argv[]) {
     widgets_apply_eink_style();
 
     /* Initialize subsystems */
+    configure_transport();
     http_global_init();
 
     /* Initialize brightness control (works on Kindle, no-op elsewhere) */
@@ -26,6 +94,10 @@ int main(int argc, char *argv[]) {
     if (!db_init()) {
         g_warning("Failed to initialize database");
     }
+    configure_rate_limits();
+    configure_network_emulation();
+    configure_page_tone();
+    g_unix_signal_add(SIGUSR1, on_dump_timings, NULL);
 
     char *cache_path = g_build_filename(g_get_user_cache_dir(),
                                          "manga-reader", NULL);
@@ -52,9 +124,11 @@ int main(int argc, char *argv[]) {
     /* Cleanup */
     app_destroy(app);
     source_registry_shutdown();
+    /* Transfers and renders write into the cache; stop them before it goes */
+    http_global_cleanup();
+    image_loader_shutdown();
     cache_shutdown();
     db_shutdown();
-    http_global_cleanup();
     brightness_shutdown();
 
     return 0;
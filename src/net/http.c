@@ -1,107 +1,2051 @@
 #include "http.h"
+#include "http_cache.h"
+#include "http_fixture.h"
+#include "net_monitor.h"
+#include "net_persist.h"
+#include "net_quality.h"
+#include "net_shaper.h"
+#include "net_stats.h"
+#include "net_timing.h"
+#include "rate_limiter.h"
+#include "retry_policy.h"
+#include "../util/cache.h"
 #include <curl/curl.h>
 #include <stdlib.h>
 #include <string.h>
 
-#define HTTP_MAX_RETRIES 3
-#define HTTP_RETRY_DELAY_US 500000  /* 0.5s */
+#define HTTP_POOL_MAX 8             /* idle easy handles kept for reuse */
+#define HTTP_MAX_ACTIVE 16          /* transfers running on the multi handle */
+#define HTTP_POLL_MAX_MS 1000
+#define HTTP_PREALLOC_MAX (32 * 1024 * 1024)  /* trust Content-Length up to this */
+#define HTTP_RESUME_MIN (128 * 1024)  /* smaller bodies just start over */
+#define HTTP_WARM_INTERVAL_US (60 * G_USEC_PER_SEC)  /* keep-alive lasts this long */
+#define HTTP_SPLIT_PARTS 4          /* byte ranges a big image is fetched as */
+#define HTTP_SPLIT_MIN (1024 * 1024)       /* smaller bodies come in one piece */
+#define HTTP_SPLIT_PART_MIN (256 * 1024)   /* no part smaller than this */
+
+#define HTTP_USER_AGENT \
+    "Mozilla/5.0 (Linux; Android 4.4.2) AppleWebKit/537.36 " \
+    "(KHTML, like Gecko) Version/4.0 Chrome/30.0.0.0 Safari/537.36"
+
+/* ── Shared connection state ───────────────────────────────────────── */
+
+static gboolean multiplex = TRUE;   /* HTTP/2 where the server offers it */
+static guint    split_parts = HTTP_SPLIT_PARTS;
+static char    *ca_file = NULL;
+static char    *state_dir = NULL;   /* net_persist files; NULL = default */
+
+/* Where responses come from; see http_set_transport */
+static HttpTransport transport = HTTP_TRANSPORT_LIVE;
+static char         *fixture_dir = NULL;
+static gboolean      replay_latency = FALSE;
+
+/* DNS, TLS sessions and live connections are shared by every handle,
+ * so back-to-back page downloads from the same CDN skip the resolve,
+ * TCP connect and TLS handshake after the first request. TLS sessions,
+ * HSTS and alt-svc also survive restarts, see net_persist. */
+static CURLSH *share = NULL;
+static GMutex  share_locks[CURL_LOCK_DATA_LAST];
+
+static void share_lock(CURL *handle, curl_lock_data data,
+                       curl_lock_access access, void *userp) {
+    (void)handle; (void)access; (void)userp;
+    g_mutex_lock(&share_locks[data]);
+}
+
+static void share_unlock(CURL *handle, curl_lock_data data, void *userp) {
+    (void)handle; (void)userp;
+    g_mutex_unlock(&share_locks[data]);
+}
+
+/* ── Handle pool ───────────────────────────────────────────────────── */
+
+static GMutex  pool_lock;
+static GSList *pool_idle = NULL;   /* CURL* ready for reuse */
+static guint   pool_idle_count = 0;
+
+static CURL *pool_acquire(void) {
+    CURL *curl = NULL;
+
+    g_mutex_lock(&pool_lock);
+    if (pool_idle) {
+        curl = pool_idle->data;
+        pool_idle = g_slist_delete_link(pool_idle, pool_idle);
+        pool_idle_count--;
+    }
+    g_mutex_unlock(&pool_lock);
+
+    if (!curl) {
+        curl = curl_easy_init();
+        if (curl && share) net_persist_attach(curl);
+    }
+    /* curl_easy_reset drops the share along with every other option, so
+     * every handle leaves the pool with it set again */
+    if (curl && share) {
+        curl_easy_setopt(curl, CURLOPT_SHARE, share);
+        net_persist_setup(curl);
+    }
+    return curl;
+}
+
+static void pool_release(CURL *curl) {
+    if (!curl) return;
+
+    /* Reset clears options but keeps the handle's caches warm */
+    curl_easy_reset(curl);
+
+    g_mutex_lock(&pool_lock);
+    if (pool_idle_count < HTTP_POOL_MAX) {
+        pool_idle = g_slist_prepend(pool_idle, curl);
+        pool_idle_count++;
+        curl = NULL;
+    }
+    g_mutex_unlock(&pool_lock);
+
+    if (curl) curl_easy_cleanup(curl);
+}
+
+/* ── Requests ──────────────────────────────────────────────────────── */
+
+typedef struct HttpRequest HttpRequest;
+
+/* A big cache download fetched as several byte ranges at once. The
+ * request that found it big keeps the first range and is the owner: it
+ * completes, for all of them, once the last part is in. Network thread
+ * only. */
+typedef struct {
+    HttpRequest *owner;
+    CacheWriter *writer;     /* parts write at their own offsets */
+    char        *validator;  /* If-Range for every part */
+    curl_off_t   length;
+    guint        running;    /* parts not finished yet, owner included */
+    gboolean     failed;
+} HttpSplit;
+
+struct HttpRequest {
+    char              *url;
+    char              *host;         /* circuit breaker key */
+    struct curl_slist *headers;
+    HttpPriority       priority;
+    NetClass           klass;        /* NET_CLASS_COUNT = from Content-Type */
+    guint64            seq;          /* FIFO order within a priority */
+    gint64             not_before;   /* monotonic µs; retry delay */
+    int                attempt;      /* failed tries so far */
+    gboolean           limited;      /* holds a rate limiter slot */
+    gboolean           paused;       /* background transfer held back */
+    gboolean           warm_up;      /* HEAD just to open a connection */
+    gboolean           probe;        /* reachability check while offline */
+    NetShape           shape;        /* emulated link, this attempt */
+    gint64             started_at;   /* monotonic µs this attempt started */
+    gdouble            overlap;      /* ∫ transfers running dt, in s */
+
+    HttpResponse      *resp;
+    size_t             capacity;     /* allocated bytes behind resp->data */
+    CURL              *curl;
+    char               errbuf[CURL_ERROR_SIZE];
+
+    /* Stream the body into the cache instead of resp->data */
+    char              *cache_key;
+    CacheWriter       *writer;
+
+    /* Validators of the final response */
+    gboolean           want_validators;  /* http_get_cached needs them */
+    char              *etag;
+    char              *last_modified;
+    gboolean           encoded;          /* Content-Encoding was applied */
+    GString           *raw_headers;      /* record: final header lines */
+
+    /* Replay: the recorded response, served once replay_due passes */
+    HttpFixture       *fixture;
+    gint64             replay_due;
+
+    /* Split download: this request fetches part_from..part_to of the
+     * split's body */
+    HttpSplit         *split;
+    curl_off_t         part_from;
+    curl_off_t         part_to;          /* inclusive */
+    curl_off_t         part_done;        /* bytes of the part on disk */
+    gboolean           no_split;         /* a split failed; fetch whole */
+    gboolean           accept_ranges;    /* server said Accept-Ranges: bytes */
+    curl_off_t         range_start;      /* from Content-Range, or -1 */
+
+    /* Continue an interrupted body with a Range request */
+    curl_off_t         resume_from;      /* body bytes already held */
+    char              *resume_validator; /* If-Range value for those bytes */
+    struct curl_slist *range_headers;    /* headers + If-Range, this attempt */
+    gboolean           range_sent;
+    gboolean           range_mismatch;   /* 206 for some other range */
+    gboolean           body_started;     /* first chunk of this attempt seen */
+    long               body_status;      /* status the body belongs to */
+
+    /* Async completion (main loop) */
+    HttpDoneFunc       on_done;
+    gpointer           user_data;
+    GCancellable      *cancel;
+
+    /* Blocking completion (http_get_with_headers) */
+    GMutex            *wait_lock;
+    GCond             *wait_cond;
+    gboolean           finished;
+
+    /* Single-flight: later GETs of the same URL share this transfer.
+     * followers and queued are guarded by engine_lock. */
+    gboolean           coalesced;    /* registered in engine_flights */
+    gboolean           abandoned;    /* every caller cancelled; being dropped */
+    GSList            *followers;    /* HttpRequest* waiting on our result */
+    gint               blocked;      /* followers a caller blocks on; atomic */
+    gboolean           queued;       /* sitting in engine_pending */
+};
+
+static void request_free(HttpRequest *req) {
+    /* Unfinished (cancelled, shutting down): keep the part for later */
+    if (req->writer) cache_writer_suspend(req->writer);
+    g_free(req->cache_key);
+    g_free(req->etag);
+    g_free(req->last_modified);
+    if (req->raw_headers) g_string_free(req->raw_headers, TRUE);
+    http_fixture_free(req->fixture);
+    g_free(req->resume_validator);
+    curl_slist_free_all(req->range_headers);
+    g_free(req->url);
+    g_free(req->host);
+    curl_slist_free_all(req->headers);
+    http_response_free(req->resp);
+    if (req->cancel) g_object_unref(req->cancel);
+    g_free(req);
+}
+
+static gboolean request_cancelled(HttpRequest *req) {
+    return req->cancel && g_cancellable_is_cancelled(req->cancel);
+}
+
+/* TRUE for the extra parts of a split download, not for its owner */
+static gboolean request_is_part(HttpRequest *req) {
+    return req->split && req->split->owner != req;
+}
+
+/* Whether a caller is blocked on the result, its own or that of a
+ * blocking call sharing the transfer; parts act for their owner */
+static gboolean request_blocking(HttpRequest *req) {
+    if (request_is_part(req)) req = req->split->owner;
+    return req->wait_cond != NULL || g_atomic_int_get(&req->blocked) > 0;
+}
+
+static gboolean flight_cancelled(HttpRequest *req);
+
+/* The emulator ended this body early without a Content-Length to give it
+ * away: the caller may see it, but it must never become a cache entry */
+static gboolean request_cut_short(HttpRequest *req) {
+    return req->shape.cut && !req->shape.drop;
+}
+
+/* Grow the body buffer so it can hold need bytes plus a NUL. The first
+ * allocation is sized from Content-Length when the server sends one. */
+static gboolean response_reserve(HttpRequest *req, size_t need) {
+    if (need + 1 <= req->capacity) return TRUE;
+
+    size_t cap = req->capacity * 2;
+    if (req->capacity == 0) {
+        curl_off_t length = -1;
+        curl_easy_getinfo(req->curl, CURLINFO_CONTENT_LENGTH_DOWNLOAD_T,
+                          &length);
+        if (length > 0 && length < HTTP_PREALLOC_MAX)
+            cap = (size_t)length + 1;
+    }
+    if (cap < need + 1) cap = need + 1;
+
+    char *tmp = g_try_realloc(req->resp->data, cap);
+    if (!tmp) return FALSE;
+    req->resp->data = tmp;
+    req->capacity = cap;
+    return TRUE;
+}
+
+/* The validator a partial body of this response can be resumed with.
+ * Weak ETags are not allowed in If-Range. */
+static const char *response_validator(HttpRequest *req) {
+    if (req->encoded) return NULL;
+    if (req->etag && strncmp(req->etag, "W/", 2) != 0) return req->etag;
+    return req->last_modified;
+}
+
+/* First body bytes of an attempt: either they continue what we already
+ * hold (206), or they replace it */
+static gboolean response_begin(HttpRequest *req) {
+    req->body_started = TRUE;
+    curl_easy_getinfo(req->curl, CURLINFO_RESPONSE_CODE, &req->body_status);
+    if (req->body_status == 206 && req->range_sent) {
+        /* Parts check their own range in part_begin. Anything but the
+         * rest of what we hold would corrupt the body. */
+        if (req->split || req->range_start == req->resume_from) return TRUE;
+        req->range_mismatch = TRUE;
+        return FALSE;
+    }
+
+    if (req->writer) {
+        /* Error pages never reach the cache, nor disturb the part */
+        if (req->body_status != 200) return TRUE;
+        if (req->resume_from > 0 && !cache_writer_truncate(req->writer))
+            return FALSE;
+
+        /* Journal large bodies so a break can be resumed, even after
+         * a restart */
+        curl_off_t length = -1;
+        curl_easy_getinfo(req->curl, CURLINFO_CONTENT_LENGTH_DOWNLOAD_T,
+                          &length);
+        const char *validator = response_validator(req);
+        if (validator && (length < 0 || length >= HTTP_RESUME_MIN))
+            http_cache_partial_save(req->cache_key, validator);
+        else
+            http_cache_partial_clear(req->cache_key);
+    }
+    req->resume_from = 0;
+    req->resp->size = 0;
+    return TRUE;
+}
+
+/* ── Split downloads ───────────────────────────────────────────────── */
+
+static HttpRequest *request_new(const char *url, const char *cache_key,
+                                const char *const *headers);
+static void engine_enqueue(HttpRequest *req);
+
+/* First body bytes of a cache download the user is about to look at. If
+ * it is big and the server takes ranges, this transfer keeps the first
+ * part and the rest are queued as parts of their own. Parts land out of
+ * order, so the body moves to a fresh file instead of the journal. */
+static void split_start(HttpRequest *req) {
+    if (split_parts < 2 || req->no_split || req->range_sent ||
+        req->body_status != 200 || !req->accept_ranges ||
+        req->priority > HTTP_PRIORITY_NEXT_VISIBLE ||
+        transport != HTTP_TRANSPORT_LIVE)
+        return;
+
+    curl_off_t length = -1;
+    curl_easy_getinfo(req->curl, CURLINFO_CONTENT_LENGTH_DOWNLOAD_T, &length);
+    const char *validator = response_validator(req);
+    if (length < HTTP_SPLIT_MIN || !validator) return;
+
+    CacheWriter *writer = cache_writer_new(req->cache_key);
+    if (!writer) return;
+    cache_writer_abort(req->writer);
+    req->writer = NULL;
+    http_cache_partial_clear(req->cache_key);
+
+    curl_off_t parts = MIN((curl_off_t)split_parts,
+                           length / HTTP_SPLIT_PART_MIN);
+    curl_off_t size = (length + parts - 1) / parts;
+    HttpSplit *split = g_new0(HttpSplit, 1);
+    split->owner = req;
+    split->writer = writer;
+    split->validator = g_strdup(validator);
+    split->length = length;
+    split->running = (guint)parts;
+
+    for (curl_off_t i = 0; i < parts; i++) {
+        HttpRequest *part = i == 0 ? req : request_new(req->url, NULL, NULL);
+        part->split = split;
+        part->part_from = i * size;
+        part->part_to = MIN(length, (i + 1) * size) - 1;
+        if (part == req) continue;
+
+        part->priority = req->priority;
+        part->klass = req->klass;
+        for (struct curl_slist *h = req->headers; h; h = h->next)
+            part->headers = curl_slist_append(part->headers, h->data);
+        engine_enqueue(part);
+    }
+}
+
+/* A part's response must be the range it asked for, of the same body */
+static gboolean part_begin(HttpRequest *req) {
+    return req->range_sent && req->body_status == 206 &&
+           req->range_start == req->part_from + req->part_done;
+}
+
+/* Write at the part's own offset, up to the end of its range. Taking
+ * less than offered ends the transfer there. */
+static size_t part_write(HttpRequest *req, const void *data, size_t len) {
+    curl_off_t at = req->part_from + req->part_done;
+    curl_off_t left = req->part_to + 1 - at;
+    size_t take = left <= 0 ? 0 : (curl_off_t)len < left ? len : (size_t)left;
+    if (take > 0 &&
+        !cache_writer_write_at(req->split->writer, (guint64)at, data, take))
+        return 0;
+    req->part_done += take;
+    req->resp->size += take;
+    return take;
+}
+
+static gboolean part_complete(HttpRequest *req) {
+    return req->part_from + req->part_done > req->part_to;
+}
+
+/* Let the emulated link (net_shaper) decide how much of a chunk has
+ * arrived. FALSE: pause the transfer and have the chunk offered again.
+ * Taking fewer bytes than offered fails the transfer at that point. */
+static gboolean shape_chunk(HttpRequest *req, size_t total, size_t *take) {
+    /* Emulation off, as it nearly always is: nothing to look up or lock */
+    if (!net_shaper_enabled()) {
+        req->shape.held = FALSE;
+        *take = total;
+        return TRUE;
+    }
+
+    long connects = 0;
+    curl_off_t length = -1;
+    if (!req->shape.started) {
+        curl_easy_getinfo(req->curl, CURLINFO_NUM_CONNECTS, &connects);
+        curl_easy_getinfo(req->curl, CURLINFO_CONTENT_LENGTH_DOWNLOAD_T,
+                          &length);
+    }
+    req->shape.held = !net_shaper_admit(&req->shape, g_get_monotonic_time(),
+                                        connects > 0, (gint64)length,
+                                        total, take);
+    return !req->shape.held;
+}
 
 static size_t write_callback(void *contents, size_t size, size_t nmemb,
                              void *userp) {
     size_t total = size * nmemb;
-    HttpResponse *resp = userp;
-    char *tmp = realloc(resp->data, resp->size + total + 1);
-    if (!tmp) return 0;
-    resp->data = tmp;
+    HttpRequest *req = userp;
+    if (!shape_chunk(req, total, &total)) return CURL_WRITEFUNC_PAUSE;
+    if (!req->body_started && !response_begin(req)) return 0;
+    HttpResponse *resp = req->resp;
+    if (!response_reserve(req, resp->size + total)) return 0;
     memcpy(resp->data + resp->size, contents, total);
     resp->size += total;
     resp->data[resp->size] = '\0';
     return total;
 }
 
-void http_global_init(void) {
-    curl_global_init(CURL_GLOBAL_DEFAULT);
+/* Chunks go straight to disk, so memory per transfer stays at one chunk */
+static size_t cache_write_callback(void *contents, size_t size, size_t nmemb,
+                                   void *userp) {
+    size_t total = size * nmemb;
+    HttpRequest *req = userp;
+    if (!shape_chunk(req, total, &total)) return CURL_WRITEFUNC_PAUSE;
+    if (!req->body_started) {
+        if (!response_begin(req)) return 0;
+        if (!req->split)
+            split_start(req);
+        else if (!part_begin(req))
+            return 0;
+    }
+    if (req->split) return part_write(req, contents, total);
+    if (req->body_status != 200 && req->body_status != 206) return total;
+    if (!cache_writer_write(req->writer, contents, total)) return 0;
+    req->resp->size += total;
+    return total;
 }
 
-void http_global_cleanup(void) {
-    curl_global_cleanup();
+/* Return the trimmed value if line is the named header, else NULL */
+static char *header_value(const char *line, size_t len, const char *name) {
+    size_t name_len = strlen(name);
+    if (len <= name_len || line[name_len] != ':' ||
+        g_ascii_strncasecmp(line, name, name_len) != 0)
+        return NULL;
+    char *value = g_strndup(line + name_len + 1, len - name_len - 1);
+    return g_strstrip(value);
 }
 
-HttpResponse *http_get(const char *url) {
-    return http_get_with_headers(url, NULL);
+static size_t header_callback(char *buffer, size_t size, size_t nitems,
+                              void *userp) {
+    size_t total = size * nitems;
+    HttpRequest *req = userp;
+    char *value;
+
+    /* A new status line starts a new response (e.g. after a redirect) */
+    gboolean status_line = total >= 5 && strncmp(buffer, "HTTP/", 5) == 0;
+    if (req->raw_headers) {
+        size_t len = total;
+        while (len > 0 && (buffer[len - 1] == '\r' || buffer[len - 1] == '\n'))
+            len--;
+        if (status_line) g_string_truncate(req->raw_headers, 0);
+        if (len > 0) {
+            if (req->raw_headers->len > 0)
+                g_string_append_c(req->raw_headers, '\n');
+            g_string_append_len(req->raw_headers, buffer, (gssize)len);
+        }
+    }
+
+    if (status_line) {
+        g_free(req->etag);
+        g_free(req->last_modified);
+        req->etag = NULL;
+        req->last_modified = NULL;
+        req->encoded = FALSE;
+        req->accept_ranges = FALSE;
+        req->range_start = -1;
+    } else if ((value = header_value(buffer, total, "Content-Encoding"))) {
+        req->encoded = value[0] && g_ascii_strcasecmp(value, "identity") != 0;
+        g_free(value);
+    } else if ((value = header_value(buffer, total, "ETag"))) {
+        g_free(req->etag);
+        req->etag = value;
+    } else if ((value = header_value(buffer, total, "Last-Modified"))) {
+        g_free(req->last_modified);
+        req->last_modified = value;
+    } else if ((value = header_value(buffer, total, "Accept-Ranges"))) {
+        req->accept_ranges = g_ascii_strcasecmp(value, "bytes") == 0;
+        g_free(value);
+    } else if ((value = header_value(buffer, total, "Content-Range"))) {
+        /* "bytes <first>-<last>/<length>" */
+        char *end = NULL;
+        if (g_ascii_strncasecmp(value, "bytes ", 6) == 0) {
+            curl_off_t first = g_ascii_strtoll(value + 6, &end, 10);
+            if (end != value + 6 && *end == '-') req->range_start = first;
+        }
+        g_free(value);
+    }
+    return total;
 }
 
-HttpResponse *http_get_with_headers(const char *url,
-                                    const char *const *headers) {
-    CURL *curl = curl_easy_init();
-    if (!curl) return NULL;
+/* Abort a running transfer as soon as its owner cancels it */
+static int xferinfo_callback(void *userp, curl_off_t dltotal, curl_off_t dlnow,
+                             curl_off_t ultotal, curl_off_t ulnow) {
+    (void)dltotal; (void)dlnow; (void)ultotal; (void)ulnow;
+    return flight_cancelled(userp) ? 1 : 0;
+}
 
-    HttpResponse *resp = g_new0(HttpResponse, 1);
+/* Prepare the response for a new attempt. Cache downloads pick up any
+ * journalled .part file; a memory body is kept if the last attempt left
+ * something resumable. */
+static gboolean request_reset_body(HttpRequest *req) {
+    if (req->split) {
+        /* What the part has so far is in the split's file */
+        http_response_free(req->resp);
+        req->resp = g_new0(HttpResponse, 1);
+        req->resume_from = 0;
+    } else if (req->cache_key) {
+        size_t have = 0;
+        if (req->writer) cache_writer_suspend(req->writer);
+        req->writer = cache_writer_resume(req->cache_key, &have);
+        if (!req->writer) return FALSE;
 
-    char errbuf[CURL_ERROR_SIZE] = {0};
+        g_free(req->resume_validator);
+        req->resume_validator = have > 0
+            ? http_cache_partial_validator(req->cache_key) : NULL;
+        if (have > 0 && !req->resume_validator) {
+            if (!cache_writer_truncate(req->writer)) return FALSE;
+            have = 0;
+        }
+        req->resume_from = (curl_off_t)have;
+        http_response_free(req->resp);
+        req->resp = g_new0(HttpResponse, 1);
+        req->resp->size = have;
+    } else if (req->resume_from == 0 || !req->resp) {
+        http_response_free(req->resp);
+        req->resp = g_new0(HttpResponse, 1);
+        req->capacity = 0;
+        req->resume_from = 0;
+    }
+    req->body_started = FALSE;
+    req->body_status = 0;
+    req->range_mismatch = FALSE;
+    return TRUE;
+}
 
-    curl_easy_setopt(curl, CURLOPT_URL, url);
-    curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, write_callback);
-    curl_easy_setopt(curl, CURLOPT_WRITEDATA, resp);
+/* HTTP/2 stream weight, so the server sends urgent streams first */
+static long priority_weight(HttpPriority priority) {
+    switch (priority) {
+    case HTTP_PRIORITY_USER_BLOCKING: return 256;
+    case HTTP_PRIORITY_NEXT_VISIBLE:  return 128;
+    case HTTP_PRIORITY_SPECULATIVE:   return 32;
+    default:                          return 1;
+    }
+}
+
+static gboolean request_setup_handle(HttpRequest *req) {
+    CURL *curl = req->curl;
+
+    if (!request_reset_body(req)) return FALSE;
+    req->errbuf[0] = '\0';
+    net_shaper_begin(&req->shape);
+    if (transport == HTTP_TRANSPORT_RECORD) {
+        if (req->raw_headers) g_string_truncate(req->raw_headers, 0);
+        else req->raw_headers = g_string_new(NULL);
+    }
+
+    curl_easy_setopt(curl, CURLOPT_URL, req->url);
+    if (req->cache_key || req->split) {
+        curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, cache_write_callback);
+        curl_easy_setopt(curl, CURLOPT_WRITEDATA, req);
+    } else {
+        curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, write_callback);
+        curl_easy_setopt(curl, CURLOPT_WRITEDATA, req);
+    }
+
+    curl_slist_free_all(req->range_headers);
+    req->range_headers = NULL;
+    req->range_sent = req->split || req->resume_from > 0;
+    if (req->range_sent) {
+        /* Ask for the rest, but only if it is still the same body */
+        char *range = req->split
+            ? g_strdup_printf("%" CURL_FORMAT_CURL_OFF_T "-%"
+                              CURL_FORMAT_CURL_OFF_T,
+                              req->part_from + req->part_done, req->part_to)
+            : g_strdup_printf("%" CURL_FORMAT_CURL_OFF_T "-",
+                              req->resume_from);
+        curl_easy_setopt(curl, CURLOPT_RANGE, range);
+        g_free(range);
+        for (struct curl_slist *h = req->headers; h; h = h->next)
+            req->range_headers = curl_slist_append(req->range_headers, h->data);
+        char *if_range = g_strdup_printf("If-Range: %s",
+                                         req->split ? req->split->validator
+                                                    : req->resume_validator);
+        req->range_headers = curl_slist_append(req->range_headers, if_range);
+        g_free(if_range);
+    } else if (!req->cache_key) {
+        /* Let curl offer every encoding it supports; the HTML pages
+         * shrink several times over and images are sent as-is anyway.
+         * Not when resuming: the range must be of the plain body. */
+        curl_easy_setopt(curl, CURLOPT_ACCEPT_ENCODING, "");
+    }
     curl_easy_setopt(curl, CURLOPT_FOLLOWLOCATION, 1L);
-    curl_easy_setopt(curl, CURLOPT_TIMEOUT, 30L);
-    curl_easy_setopt(curl, CURLOPT_ERRORBUFFER, errbuf);
+    if (req->warm_up)
+        curl_easy_setopt(curl, CURLOPT_NOBODY, 1L);
+    if (multiplex && !request_is_part(req)) {
+        /* One connection per CDN host: each page of a chapter becomes a
+         * stream on it, and new transfers wait for that connection to
+         * come up rather than opening their own */
+        curl_easy_setopt(curl, CURLOPT_HTTP_VERSION,
+                         (long)CURL_HTTP_VERSION_2TLS);
+        /* Plain http:// stays on HTTP/1.1, where waiting would put
+         * every transfer to a host behind the first one */
+        if (g_ascii_strncasecmp(req->url, "https:", 6) == 0)
+            curl_easy_setopt(curl, CURLOPT_PIPEWAIT, 1L);
+        curl_easy_setopt(curl, CURLOPT_STREAM_WEIGHT,
+                         priority_weight(req->priority));
+    } else {
+        /* Parts of a split each want a connection of their own: as
+         * streams of one they would share its bandwidth */
+        curl_easy_setopt(curl, CURLOPT_HTTP_VERSION,
+                         (long)CURL_HTTP_VERSION_1_1);
+    }
+    /* Downloads have no overall deadline: a big page on a slow link is
+     * fine as long as it keeps moving. A request the user is waiting on
+     * does, or a server trickling just above the stall limit would keep
+     * the UI waiting without end. All limits follow the measured link. */
+    long low_speed, low_speed_time;
+    net_quality_low_speed(&low_speed, &low_speed_time);
+    curl_easy_setopt(curl, CURLOPT_CONNECTTIMEOUT, net_quality_connect_timeout());
+    curl_easy_setopt(curl, CURLOPT_LOW_SPEED_LIMIT, low_speed);
+    curl_easy_setopt(curl, CURLOPT_LOW_SPEED_TIME, low_speed_time);
+    if (req->priority == HTTP_PRIORITY_USER_BLOCKING && !req->cache_key &&
+        !req->split)
+        curl_easy_setopt(curl, CURLOPT_TIMEOUT, net_quality_total_timeout());
+    curl_easy_setopt(curl, CURLOPT_ERRORBUFFER, req->errbuf);
+    curl_easy_setopt(curl, CURLOPT_PRIVATE, req);
+    if (req->cancel || req->split) {
+        curl_easy_setopt(curl, CURLOPT_XFERINFOFUNCTION, xferinfo_callback);
+        curl_easy_setopt(curl, CURLOPT_XFERINFODATA, req);
+        curl_easy_setopt(curl, CURLOPT_NOPROGRESS, 0L);
+    }
 #ifdef __APPLE__
     /* Use macOS Secure Transport native CA store */
     curl_easy_setopt(curl, CURLOPT_SSL_OPTIONS, CURLSSLOPT_NATIVE_CA);
 #endif
-    curl_easy_setopt(curl, CURLOPT_USERAGENT,
-        "Mozilla/5.0 (Linux; Android 4.4.2) AppleWebKit/537.36 "
-        "(KHTML, like Gecko) Version/4.0 Chrome/30.0.0.0 Safari/537.36");
+    if (ca_file)
+        curl_easy_setopt(curl, CURLOPT_CAINFO, ca_file);
+    curl_easy_setopt(curl, CURLOPT_USERAGENT, HTTP_USER_AGENT);
+    if (req->range_headers)
+        curl_easy_setopt(curl, CURLOPT_HTTPHEADER, req->range_headers);
+    else if (req->headers)
+        curl_easy_setopt(curl, CURLOPT_HTTPHEADER, req->headers);
+    curl_easy_setopt(curl, CURLOPT_HEADERFUNCTION, header_callback);
+    curl_easy_setopt(curl, CURLOPT_HEADERDATA, req);
+    return TRUE;
+}
 
-    struct curl_slist *header_list = NULL;
-    if (headers) {
-        for (int i = 0; headers[i]; i++) {
-            header_list = curl_slist_append(header_list, headers[i]);
+/* ── Network thread ────────────────────────────────────────────────── */
+
+/* One thread drives every transfer through a curl multi handle.
+ * Callers only touch the pending queue; everything else below is
+ * owned by the network thread. */
+static CURLM    *multi = NULL;
+static GThread  *engine_thread = NULL;
+static GMutex    engine_lock;
+static GQueue    engine_pending = G_QUEUE_INIT;   /* HttpRequest*, sorted */
+static gboolean  engine_quit = FALSE;
+static gboolean  engine_closed = FALSE;           /* drained; takes no more */
+static guint64   engine_seq = 0;
+static GList    *engine_active = NULL;            /* HttpRequest* on multi */
+static guint     engine_active_count = 0;
+static gint64    engine_overlap_at = 0;           /* last engine_note_overlap */
+static GHashTable *engine_flights = NULL;         /* url → leading request */
+static guint     engine_paused_count = 0;
+static GHashTable *engine_warmed = NULL;          /* host → gint64* µs */
+static char     *engine_probe_host = NULL;        /* last host that answered */
+static char     *engine_probe_url = NULL;         /* and the root of its site */
+static gboolean  engine_probing = FALSE;          /* a probe is in flight */
+static gboolean  engine_clearing = FALSE;         /* http_clear_cache waits */
+static GCond     engine_cleared;
+static GNetworkMonitor *engine_link = NULL;
+
+static gint pending_compare(gconstpointer a, gconstpointer b,
+                            gpointer user_data) {
+    (void)user_data;
+    const HttpRequest *ra = a, *rb = b;
+    if (ra->priority != rb->priority)
+        return ra->priority < rb->priority ? -1 : 1;
+    return ra->seq < rb->seq ? -1 : 1;
+}
+
+static void request_fail(HttpRequest *req);
+
+static void engine_enqueue(HttpRequest *req) {
+    g_mutex_lock(&engine_lock);
+    gboolean closed = engine_closed;
+    if (!closed) {
+        req->seq = engine_seq++;
+        req->queued = TRUE;
+        g_queue_insert_sorted(&engine_pending, req, pending_compare, NULL);
+    }
+    g_mutex_unlock(&engine_lock);
+    /* Too late: the engine is shutting down and nothing would run it */
+    if (closed)
+        request_fail(req);
+    else if (multi)
+        curl_multi_wakeup(multi);
+}
+
+/* ── Single-flight ─────────────────────────────────────────────────── */
+
+/* Requests with their own headers or validators get a response shaped
+ * for them alone, so only plain GETs share a transfer. */
+static gboolean request_can_coalesce(HttpRequest *req) {
+    return !req->headers && !req->want_validators && !req->warm_up;
+}
+
+/* TRUE while anyone still wants the leader's result. engine_lock held. */
+static gboolean flight_live_locked(HttpRequest *leader) {
+    if (request_is_part(leader)) leader = leader->split->owner;
+    if (!request_cancelled(leader)) return TRUE;
+    for (GSList *l = leader->followers; l; l = l->next) {
+        if (!request_cancelled(l->data)) return TRUE;
+    }
+    return FALSE;
+}
+
+/* A shared transfer is only abandoned once every caller has cancelled.
+ * From then on nobody may join it: it is about to fail. */
+static gboolean flight_cancelled(HttpRequest *req) {
+    if (request_is_part(req)) req = req->split->owner;
+    if (!request_cancelled(req)) return FALSE;
+    g_mutex_lock(&engine_lock);
+    gboolean live = flight_live_locked(req);
+    if (!live) req->abandoned = TRUE;
+    g_mutex_unlock(&engine_lock);
+    return !live;
+}
+
+/* Queue a new request, or attach it to an identical one in flight */
+static void engine_submit(HttpRequest *req) {
+    if (request_can_coalesce(req)) {
+        g_mutex_lock(&engine_lock);
+        if (engine_closed) {
+            g_mutex_unlock(&engine_lock);
+            request_fail(req);
+            return;
         }
-        curl_easy_setopt(curl, CURLOPT_HTTPHEADER, header_list);
+        HttpRequest *leader = g_hash_table_lookup(engine_flights, req->url);
+        if (leader && !leader->abandoned && flight_live_locked(leader)) {
+            leader->followers = g_slist_prepend(leader->followers, req);
+            if (req->wait_cond) g_atomic_int_inc(&leader->blocked);
+            if (req->priority < leader->priority) {
+                /* The most urgent caller decides where the transfer queues */
+                if (leader->queued) {
+                    g_queue_remove(&engine_pending, leader);
+                    leader->priority = req->priority;
+                    g_queue_insert_sorted(&engine_pending, leader,
+                                          pending_compare, NULL);
+                } else {
+                    leader->priority = req->priority;
+                }
+            }
+            g_mutex_unlock(&engine_lock);
+            return;
+        }
+        g_hash_table_replace(engine_flights, req->url, req);
+        req->coalesced = TRUE;
+        g_mutex_unlock(&engine_lock);
     }
+    engine_enqueue(req);
+}
 
-    CURLcode res = CURLE_OK;
-    for (int attempt = 0; attempt < HTTP_MAX_RETRIES; attempt++) {
-        /* Reset response buffer between retries */
-        free(resp->data);
-        resp->data = NULL;
-        resp->size = 0;
-        errbuf[0] = '\0';
+/* Build a follower's own response from the leader's result. A follower
+ * may want the body in memory while the leader streamed it to the cache,
+ * or the other way round. */
+static HttpResponse *flight_share_response(HttpRequest *leader,
+                                           HttpRequest *follower) {
+    HttpResponse *src = leader->resp;
+    if (!src) return NULL;
 
-        res = curl_easy_perform(curl);
-        if (res == CURLE_OK) {
-            curl_easy_getinfo(curl, CURLINFO_RESPONSE_CODE,
-                              &resp->status_code);
+    if (follower->cache_key && leader->cache_key &&
+        strcmp(follower->cache_key, leader->cache_key) == 0) {
+        HttpResponse *resp = g_new0(HttpResponse, 1);
+        resp->status_code = src->status_code;
+        resp->size = src->size;
+        return resp;
+    }
+
+    GBytes *body = NULL;
+    if (src->body) {
+        body = g_bytes_ref(src->body);
+    } else if (leader->cache_key) {
+        size_t len = 0;
+        char *data = cache_get(leader->cache_key, &len);
+        if (data) body = g_bytes_new_take(data, len);
+    }
+    if (!body) return NULL;
+
+    HttpResponse *resp = g_new0(HttpResponse, 1);
+    resp->status_code = src->status_code;
+    if (follower->cache_key) {
+        gsize len = 0;
+        const void *data = g_bytes_get_data(body, &len);
+        gboolean stored = src->status_code == 200 &&
+                          !request_cut_short(leader) &&
+                          cache_put(follower->cache_key, data, len);
+        g_bytes_unref(body);
+        if (!stored) {
+            g_free(resp);
+            return NULL;
+        }
+        resp->size = len;
+    } else {
+        resp->body = body;
+        resp->data = (char *)g_bytes_get_data(body, &resp->size);
+    }
+    return resp;
+}
+
+static void request_complete(HttpRequest *req);
+static void engine_release_slot(HttpRequest *req);
+static HttpRequest *request_new(const char *url, const char *cache_key,
+                                const char *const *headers);
+static char *url_root(const char *url);
+
+/* Close the flight so new callers start afresh, then hand every
+ * follower its copy of the result */
+static void flight_complete(HttpRequest *leader) {
+    g_mutex_lock(&engine_lock);
+    if (g_hash_table_lookup(engine_flights, leader->url) == leader)
+        g_hash_table_remove(engine_flights, leader->url);
+    GSList *followers = leader->followers;
+    leader->followers = NULL;
+    leader->coalesced = FALSE;
+    g_mutex_unlock(&engine_lock);
+
+    for (GSList *l = followers; l; l = l->next) {
+        HttpRequest *follower = l->data;
+        if (!request_cancelled(follower))
+            follower->resp = flight_share_response(leader, follower);
+        request_complete(follower);
+    }
+    g_slist_free(followers);
+}
+
+static gboolean dispatch_done(gpointer user_data) {
+    HttpRequest *req = user_data;
+    if (!request_cancelled(req)) {
+        HttpResponse *resp = req->resp;
+        req->resp = NULL;
+        req->on_done(resp, req->user_data);
+    }
+    request_free(req);
+    return FALSE;
+}
+
+/* One part of a split is over, one way or another (resp NULL on failure).
+ * Returns TRUE if req must not complete yet: the owner waits for every
+ * part, and goes round again as a whole download if any of them failed. */
+static gboolean split_part_done(HttpRequest *req) {
+    HttpSplit *split = req->split;
+    HttpRequest *owner = split->owner;
+    if (!req->resp) split->failed = TRUE;
+    if (req != owner) req->split = NULL;
+    if (--split->running > 0) return req == owner;
+
+    gboolean stored = FALSE;
+    if (split->failed)
+        cache_writer_abort(split->writer);
+    else
+        stored = cache_writer_commit(split->writer);
+    curl_off_t length = split->length;
+    owner->split = NULL;
+    g_free(split->validator);
+    g_free(split);
+
+    http_response_free(owner->resp);
+    owner->resp = NULL;
+    if (stored) {
+        owner->resp = g_new0(HttpResponse, 1);
+        owner->resp->status_code = 200;
+        owner->resp->size = (size_t)length;
+    } else if (!flight_cancelled(owner) && !g_atomic_int_get(&engine_quit)) {
+        g_warning("Split download failed for %s; fetching it whole",
+                  owner->url);
+        owner->no_split = TRUE;
+        engine_enqueue(owner);
+        return req == owner;
+    }
+    if (req != owner) request_complete(owner);
+    return FALSE;
+}
+
+/* Hand a finished request back to whoever is waiting on it.
+ * resp is left NULL on failure. */
+static void request_complete(HttpRequest *req) {
+    if (req->split && split_part_done(req)) return;
+    if (req->probe) engine_probing = FALSE;
+    engine_release_slot(req);
+    if (req->coalesced)
+        flight_complete(req);
+
+    if (req->wait_cond) {
+        g_mutex_lock(req->wait_lock);
+        req->finished = TRUE;
+        g_cond_signal(req->wait_cond);
+        g_mutex_unlock(req->wait_lock);
+    } else if (request_cancelled(req) || !req->on_done) {
+        request_free(req);
+    } else {
+        g_idle_add(dispatch_done, req);
+    }
+}
+
+/* Replay: the fixture stands in for the transfer. It holds its active
+ * slot until the recorded duration has passed, so the scheduler sees
+ * the same concurrency it would live. */
+static void replay_start(HttpRequest *req) {
+    req->fixture = http_fixture_load(fixture_dir, req->url);
+    req->replay_due = g_get_monotonic_time();
+    if (req->fixture && replay_latency)
+        req->replay_due += req->fixture->total_us;
+    engine_active = g_list_prepend(engine_active, req);
+    engine_active_count++;
+}
+
+/* Credit every running transfer with how many shared the link since the
+ * last change; call before engine_active_count changes */
+static void engine_note_overlap(gint64 now) {
+    gdouble span = (now - engine_overlap_at) / (gdouble)G_USEC_PER_SEC;
+    for (GList *l = engine_active; l; l = l->next) {
+        HttpRequest *req = l->data;
+        req->overlap += span * engine_active_count;
+    }
+    engine_overlap_at = now;
+}
+
+/* Complete req without a response. A retry waiting in the queue may
+ * still hold the body it had parked for resuming. */
+static void request_fail(HttpRequest *req) {
+    http_response_free(req->resp);
+    req->resp = NULL;
+    request_complete(req);
+}
+
+static void engine_start(HttpRequest *req) {
+    if (transport == HTTP_TRANSPORT_REPLAY) {
+        replay_start(req);
+        return;
+    }
+    req->curl = pool_acquire();
+    if (!req->curl || !request_setup_handle(req)) {
+        pool_release(req->curl);
+        req->curl = NULL;
+        request_fail(req);
+        return;
+    }
+    curl_multi_add_handle(multi, req->curl);
+    gint64 now = g_get_monotonic_time();
+    engine_note_overlap(now);
+    req->started_at = now;
+    req->overlap = 0;
+    engine_active = g_list_prepend(engine_active, req);
+    engine_active_count++;
+}
+
+static void engine_release_slot(HttpRequest *req) {
+    if (!req->limited) return;
+    rate_limiter_release(req->host);
+    req->limited = FALSE;
+}
+
+/* TRUE while a user-blocking request is running or next in line */
+static gboolean engine_urgent(void) {
+    for (GList *l = engine_active; l; l = l->next) {
+        HttpRequest *req = l->data;
+        if (req->priority == HTTP_PRIORITY_USER_BLOCKING) return TRUE;
+    }
+    g_mutex_lock(&engine_lock);
+    HttpRequest *head = g_queue_peek_head(&engine_pending);
+    gboolean urgent = head && head->priority == HTTP_PRIORITY_USER_BLOCKING;
+    g_mutex_unlock(&engine_lock);
+    return urgent;
+}
+
+/* Pause running background transfers while the user waits on something,
+ * so they give up their bandwidth, and let them continue afterwards */
+static void engine_throttle_background(gboolean urgent) {
+    for (GList *l = engine_active; l; l = l->next) {
+        HttpRequest *req = l->data;
+        /* The priority can be raised meanwhile by a coalesced caller */
+        gboolean pause = urgent && req->priority == HTTP_PRIORITY_BACKGROUND;
+        /* Replays have no transfer to pause; they only wait out a time */
+        if (req->paused == pause || !req->curl) continue;
+        curl_easy_pause(req->curl, pause ? CURLPAUSE_RECV : CURLPAUSE_CONT);
+        req->paused = pause;
+        if (pause)
+            engine_paused_count++;
+        else
+            engine_paused_count--;
+    }
+}
+
+/* Offline: ask the last server that answered (or the one the next queued
+ * request is for) whether it can be reached again. Any reply at all
+ * brings the engine back online. */
+static void engine_probe(void) {
+    /* A probe slower than the probe interval must not gather company */
+    if (engine_probing) return;
+
+    char *url = g_strdup(engine_probe_url);
+    if (!url) {
+        g_mutex_lock(&engine_lock);
+        HttpRequest *head = g_queue_peek_head(&engine_pending);
+        url = head ? url_root(head->url) : NULL;
+        g_mutex_unlock(&engine_lock);
+    }
+    if (!url) return;
+
+    HttpRequest *req = request_new(url, NULL, NULL);
+    g_free(url);
+    req->warm_up = TRUE;
+    req->probe = TRUE;
+    /* Not user-blocking, or every probe would pause background work */
+    req->priority = HTTP_PRIORITY_SPECULATIVE;
+    req->klass = NET_CLASS_HTML;
+    engine_probing = TRUE;
+    engine_enqueue(req);
+}
+
+/* Move due requests from the pending queue onto the multi handle, as far
+ * as the link estimate and per-host limits allow. User-blocking requests
+ * may go beyond the estimate; background ones wait while the user does.
+ * Requests for a host whose circuit is open fail straight away.
+ * Returns the delay in ms until a deferred request may be ready, or -1. */
+static long engine_start_pending(void) {
+    gint64 now = g_get_monotonic_time();
+    long next_ms = -1;
+    GSList *ready = NULL;
+    GSList *rejected = NULL;
+    gboolean urgent = engine_urgent();
+    guint limit = MIN(net_quality_concurrency(), HTTP_MAX_ACTIVE);
+    guint busy = engine_active_count - engine_paused_count;
+    guint total = engine_active_count;
+    gboolean online = net_monitor_online();
+
+    engine_throttle_background(urgent);
+
+    g_mutex_lock(&engine_lock);
+    GList *l = engine_pending.head;
+    while (l && total < HTTP_MAX_ACTIVE) {
+        GList *next = l->next;
+        HttpRequest *req = l->data;
+
+        /* The queue is sorted, so nothing further back can go either */
+        if (req->priority != HTTP_PRIORITY_USER_BLOCKING && busy >= limit)
             break;
+
+        gboolean live = flight_live_locked(req);
+        gboolean offline = !online && !req->probe;
+        gint64 resume_at = req->not_before;
+        RetryHostState state = RETRY_HOST_ALLOW;
+
+        /* Offline, a caller blocked on the result hears so at once;
+         * everything else waits until the network is back */
+        if (live && offline && request_blocking(req))
+            state = RETRY_HOST_REJECT;
+        else if (live && offline)
+            state = RETRY_HOST_DEFER;
+        else if (live && req->not_before > now)
+            state = RETRY_HOST_DEFER;
+        else if (live && urgent && req->priority == HTTP_PRIORITY_BACKGROUND)
+            state = RETRY_HOST_DEFER;    /* resumes once the user is served */
+        /* Warm-ups (and probes) are not real requests: they neither use
+         * up the host's allowance nor take the breaker's half-open slot */
+        else if (live && !req->warm_up &&
+                 !rate_limiter_ready(req->host, now, &resume_at))
+            state = RETRY_HOST_DEFER;
+        else if (live && !req->warm_up)
+            state = retry_host_check(req->host, now, request_blocking(req),
+                                     &resume_at);
+
+        if (state == RETRY_HOST_DEFER) {
+            /* resume_at is 0 while waiting on a host slot or the network;
+             * finishing transfers and probes wake the loop for that */
+            if (resume_at > now) {
+                long wait_ms = (long)((resume_at - now) / 1000) + 1;
+                if (next_ms < 0 || wait_ms < next_ms) next_ms = wait_ms;
+            }
+        } else {
+            g_queue_delete_link(&engine_pending, l);
+            req->queued = FALSE;
+            if (state == RETRY_HOST_REJECT) {
+                rejected = g_slist_prepend(rejected, req);
+            } else {
+                if (live && !req->warm_up) {
+                    rate_limiter_acquire(req->host, now);
+                    req->limited = TRUE;
+                }
+                ready = g_slist_prepend(ready, req);
+                busy++;
+                total++;
+            }
         }
+        l = next;
+    }
+    g_mutex_unlock(&engine_lock);
+
+    for (GSList *r = rejected; r; r = r->next)
+        request_fail(r->data);
+    g_slist_free(rejected);
 
-        if (attempt < HTTP_MAX_RETRIES - 1) {
-            g_warning("HTTP GET attempt %d/%d failed for %s: %s%s%s",
-                      attempt + 1, HTTP_MAX_RETRIES, url,
-                      curl_easy_strerror(res),
-                      errbuf[0] ? " — " : "", errbuf);
-            g_usleep(HTTP_RETRY_DELAY_US);
+    ready = g_slist_reverse(ready);
+    for (GSList *r = ready; r; r = r->next) {
+        HttpRequest *req = r->data;
+        if (flight_cancelled(req))
+            request_fail(req);
+        else
+            engine_start(req);
+    }
+    g_slist_free(ready);
+
+    gint64 probe_at = 0;
+    if (!online && net_monitor_probe_due(now, &probe_at))
+        engine_probe();
+    if (probe_at > now) {
+        long wait_ms = (long)((probe_at - now) / 1000) + 1;
+        if (next_ms < 0 || wait_ms < next_ms) next_ms = wait_ms;
+    }
+    return next_ms;
+}
+
+/* Work out what a request was for when the caller did not say */
+static NetClass request_class(HttpRequest *req) {
+    if (req->klass != NET_CLASS_COUNT) return req->klass;
+
+    const char *type = NULL;
+    curl_easy_getinfo(req->curl, CURLINFO_CONTENT_TYPE, &type);
+    if (type && g_ascii_strncasecmp(type, "image/", 6) == 0)
+        return NET_CLASS_IMAGE;
+    if (!type || g_ascii_strncasecmp(type, "text/", 5) == 0)
+        return NET_CLASS_HTML;
+    return NET_CLASS_UPDATE;
+}
+
+static void record_stats(HttpRequest *req) {
+    curl_off_t body = 0;
+    long header = 0;
+    double total = 0;
+    curl_easy_getinfo(req->curl, CURLINFO_SIZE_DOWNLOAD_T, &body);
+    curl_easy_getinfo(req->curl, CURLINFO_HEADER_SIZE, &header);
+    curl_easy_getinfo(req->curl, CURLINFO_TOTAL_TIME, &total);
+
+    /* Bytes carried over from an earlier attempt were counted then */
+    guint64 decoded = req->resp && req->resp->size > (size_t)req->resume_from
+                    ? req->resp->size - (size_t)req->resume_from : 0;
+    net_stats_record(request_class(req), (guint64)body + (guint64)header,
+                     decoded, total);
+}
+
+/* Keep where this attempt spent its time, for net_timing dumps */
+static void record_timing(HttpRequest *req, CURLcode res) {
+    NetTiming t;
+    memset(&t, 0, sizeof(t));
+    curl_easy_getinfo(req->curl, CURLINFO_NAMELOOKUP_TIME_T, &t.namelookup_us);
+    curl_easy_getinfo(req->curl, CURLINFO_CONNECT_TIME_T, &t.connect_us);
+    curl_easy_getinfo(req->curl, CURLINFO_APPCONNECT_TIME_T, &t.appconnect_us);
+    curl_easy_getinfo(req->curl, CURLINFO_STARTTRANSFER_TIME_T,
+                      &t.starttransfer_us);
+    curl_easy_getinfo(req->curl, CURLINFO_TOTAL_TIME_T, &t.total_us);
+    curl_easy_getinfo(req->curl, CURLINFO_RESPONSE_CODE, &t.status);
+
+    curl_off_t size = 0;
+    curl_easy_getinfo(req->curl, CURLINFO_SIZE_DOWNLOAD_T, &size);
+    t.size = (guint64)size;
+    t.started = g_get_real_time() - t.total_us;
+    t.result = (int)res;
+    t.attempt = req->attempt + 1;
+    t.priority = (int)req->priority;
+    g_strlcpy(t.url, req->url, sizeof(t.url));
+    net_timing_record(&t);
+}
+
+/* Feed a finished transfer's timings to the link estimate */
+static void record_quality(HttpRequest *req, CURLcode res) {
+    if (res != CURLE_OK) return;
+
+    curl_off_t body = 0, pretransfer = 0, starttransfer = 0, total = 0;
+    curl_easy_getinfo(req->curl, CURLINFO_SIZE_DOWNLOAD_T, &body);
+    curl_easy_getinfo(req->curl, CURLINFO_PRETRANSFER_TIME_T, &pretransfer);
+    curl_easy_getinfo(req->curl, CURLINFO_STARTTRANSFER_TIME_T, &starttransfer);
+    curl_easy_getinfo(req->curl, CURLINFO_TOTAL_TIME_T, &total);
+
+    /* On average, how many transfers shared the link with this one */
+    gint64 lifetime = g_get_monotonic_time() - req->started_at;
+    gdouble parallel = lifetime > 0
+        ? req->overlap / (lifetime / (gdouble)G_USEC_PER_SEC) : 1;
+
+    net_quality_record((guint64)body,
+                       (starttransfer - pretransfer) / (gdouble)G_USEC_PER_SEC,
+                       (total - starttransfer) / (gdouble)G_USEC_PER_SEC,
+                       parallel);
+}
+
+/* An attempt failed: hold on to what arrived if the next attempt (or, for
+ * cache downloads, the next run) can resume it */
+static void request_park_body(HttpRequest *req) {
+    if (req->split) return;   /* the part so far is in the split's file */
+    gboolean fresh = req->body_started &&
+                     (req->body_status == 200 || req->body_status == 206);
+
+    if (req->writer) {
+        /* response_begin journalled the part if it is resumable */
+        cache_writer_suspend(req->writer);
+        req->writer = NULL;
+        return;
+    }
+
+    if (!req->body_started) return;   /* nothing new; keep what we had */
+    const char *validator = req->body_status == 206
+                          ? req->resume_validator : response_validator(req);
+    if (fresh && validator && req->resp && req->resp->size > 0) {
+        char *copy = g_strdup(validator);
+        g_free(req->resume_validator);
+        req->resume_validator = copy;
+        req->resume_from = (curl_off_t)req->resp->size;
+        return;
+    }
+    http_response_free(req->resp);
+    req->resp = NULL;
+    req->resume_from = 0;
+}
+
+/* Throw away a partial body the server no longer recognises */
+static void request_discard_partial(HttpRequest *req) {
+    if (req->writer) {
+        cache_writer_abort(req->writer);
+        req->writer = NULL;
+        http_cache_partial_clear(req->cache_key);
+    }
+    http_response_free(req->resp);
+    req->resp = NULL;
+    req->resume_from = 0;
+}
+
+/* Record: keep the final response as a fixture for later replay */
+static void record_fixture(HttpRequest *req, curl_off_t ttfb_us,
+                           curl_off_t total_us) {
+    if (transport != HTTP_TRANSPORT_RECORD || req->warm_up || !req->resp)
+        return;
+
+    HttpFixture fx = {
+        .status = req->resp->status_code,
+        .etag = req->etag,
+        .last_modified = req->last_modified,
+        .headers = req->raw_headers ? req->raw_headers->str : NULL,
+        .ttfb_us = (gint64)ttfb_us,
+        .total_us = (gint64)total_us,
+    };
+    if (req->resp->body)
+        fx.body = g_bytes_ref(req->resp->body);
+    else if (req->cache_key)
+        fx.body = cache_get_bytes(req->cache_key);
+
+    GPtrArray *headers = g_ptr_array_new();
+    for (struct curl_slist *h = req->headers; h; h = h->next)
+        g_ptr_array_add(headers, h->data);
+    g_ptr_array_add(headers, NULL);
+
+    if (!http_fixture_save(fixture_dir, req->url,
+                           (const char *const *)headers->pdata, &fx))
+        g_warning("Could not record %s in %s", req->url, fixture_dir);
+
+    g_ptr_array_free(headers, TRUE);
+    if (fx.body) g_bytes_unref(fx.body);
+}
+
+static void engine_finish(HttpRequest *req, CURLcode res) {
+    /* The emulator cut the body: a dropped connection, or one that
+     * closed early. With a Content-Length curl would notice the early
+     * close; without one the body looks complete, but is kept out of
+     * the cache (see request_cut_short). */
+    if (req->shape.cut) {
+        curl_off_t length = -1;
+        curl_easy_getinfo(req->curl, CURLINFO_CONTENT_LENGTH_DOWNLOAD_T,
+                          &length);
+        if (req->shape.drop)
+            res = CURLE_RECV_ERROR;
+        else
+            res = length >= 0 ? CURLE_PARTIAL_FILE : CURLE_OK;
+        if (res != CURLE_OK)
+            g_strlcpy(req->errbuf, req->shape.drop
+                                   ? "dropped by network emulation"
+                                   : "cut short by network emulation",
+                      sizeof(req->errbuf));
+    }
+    /* A part stops where its range ends, even if the server would go on;
+     * one that stops short did not finish */
+    if (req->split) {
+        if (part_complete(req))
+            res = CURLE_OK;
+        else if (res == CURLE_OK)
+            res = CURLE_PARTIAL_FILE;
+    }
+    engine_note_overlap(g_get_monotonic_time());
+    if (!req->warm_up) record_stats(req);
+    record_quality(req, res);
+    record_timing(req, res);
+    engine_release_slot(req);
+    curl_multi_remove_handle(multi, req->curl);
+    engine_active = g_list_remove(engine_active, req);
+    engine_active_count--;
+    if (req->paused) {
+        req->paused = FALSE;
+        engine_paused_count--;
+    }
+
+    long header_size = 0;
+    curl_easy_getinfo(req->curl, CURLINFO_HEADER_SIZE, &header_size);
+    gboolean was_online = net_monitor_online();
+    net_monitor_report(res, header_size > 0);
+    if (!was_online && net_monitor_online())
+        curl_multi_wakeup(multi);    /* start what was held back */
+    if (header_size > 0 && req->host &&
+        g_strcmp0(req->host, engine_probe_host) != 0) {
+        g_free(engine_probe_host);
+        g_free(engine_probe_url);
+        engine_probe_host = g_strdup(req->host);
+        engine_probe_url = url_root(req->url);
+    }
+
+    long status = 0;
+    curl_off_t retry_after = 0, ttfb_us = 0, total_us = 0;
+    if (res == CURLE_OK) {
+        curl_easy_getinfo(req->curl, CURLINFO_RESPONSE_CODE, &status);
+        curl_easy_getinfo(req->curl, CURLINFO_RETRY_AFTER, &retry_after);
+        curl_easy_getinfo(req->curl, CURLINFO_STARTTRANSFER_TIME_T, &ttfb_us);
+        curl_easy_getinfo(req->curl, CURLINFO_TOTAL_TIME_T, &total_us);
+
+        /* Parts use HTTP/1.1 on purpose and say nothing about the host */
+        long version = 0;
+        curl_easy_getinfo(req->curl, CURLINFO_HTTP_VERSION, &version);
+        if (!request_is_part(req) && version != 0)
+            rate_limiter_set_multiplexed(req->host,
+                                         version >= CURL_HTTP_VERSION_2_0);
+    }
+    pool_release(req->curl);
+    req->curl = NULL;
+
+    if (res != CURLE_OK && flight_cancelled(req)) {
+        request_park_body(req);
+        request_fail(req);
+        return;
+    }
+
+    if (req->range_sent) {
+        if (req->split && status == 416) {
+            /* The range no longer fits the body: the owner gives up on
+             * the split and fetches it whole once every part is done */
+            request_fail(req);
+            return;
+        }
+        if (status == 416 || req->range_mismatch) {
+            /* What we hold no longer fits the resource, or the server
+             * sent some other range; fetch it whole. Counted as a failed
+             * attempt, so a server that keeps doing it is given up on. */
+            request_discard_partial(req);
+            req->attempt++;
+            if (retry_delay_us(req->attempt, 0) < 0) {
+                g_warning("HTTP GET failed after %d attempts for %s: "
+                          "range not satisfiable", req->attempt, req->url);
+                request_fail(req);
+                return;
+            }
+            engine_enqueue(req);
+            return;
+        }
+        /* The rest has been appended: the caller sees the full body */
+        if (status == 206) status = 200;
+    }
+
+    /* A failed warm-up must not count against the host before the
+     * request it was for has even been sent */
+    RetryOutcome outcome = retry_classify(res, status);
+    if (!req->warm_up)
+        retry_host_report(req->host, outcome, retry_after);
+
+    if (outcome != RETRY_OUTCOME_OK) {
+        char *reason = res == CURLE_OK
+            ? g_strdup_printf("HTTP %ld", status)
+            : g_strdup_printf("%s%s%s", curl_easy_strerror(res),
+                              req->errbuf[0] ? " — " : "", req->errbuf);
+        req->attempt++;
+
+        gint64 delay = -1;
+        gint64 unused;
+        /* Nobody blocked on a result should sit out backoffs offline */
+        gboolean waiting = request_blocking(req) && !net_monitor_online();
+        if (outcome == RETRY_OUTCOME_TRANSIENT && !req->warm_up && !waiting &&
+            retry_host_check(req->host, g_get_monotonic_time(),
+                             request_blocking(req),
+                             &unused) != RETRY_HOST_REJECT)
+            delay = retry_delay_us(req->attempt, retry_after);
+
+        if (delay >= 0) {
+            g_warning("HTTP GET attempt %d failed for %s: %s; retrying in %.1f s",
+                      req->attempt, req->url, reason,
+                      delay / (double)G_USEC_PER_SEC);
+            g_free(reason);
+            /* Retry later without holding up the other transfers */
+            request_park_body(req);
+            req->not_before = g_get_monotonic_time() + delay;
+            engine_enqueue(req);
+            return;
         }
+
+        g_warning("HTTP GET failed after %d attempt%s for %s: %s",
+                  req->attempt, req->attempt == 1 ? "" : "s",
+                  req->url, reason);
+        g_free(reason);
     }
 
     if (res != CURLE_OK) {
-        g_warning("HTTP GET failed after %d attempts for %s: %s%s%s",
-                  HTTP_MAX_RETRIES, url,
-                  curl_easy_strerror(res),
-                  errbuf[0] ? " — " : "", errbuf);
-        http_response_free(resp);
-        resp = NULL;
+        request_park_body(req);
+        request_fail(req);
+        return;
+    }
+
+    /* A final error status still reaches the caller, who checks it */
+    req->resp->status_code = status;
+    if (req->writer) {
+        /* Only a complete 200 body becomes a cache entry */
+        gboolean stored = FALSE;
+        if (status == 200 && !request_cut_short(req))
+            stored = cache_writer_commit(req->writer);
+        else
+            cache_writer_abort(req->writer);
+        req->writer = NULL;
+        http_cache_partial_clear(req->cache_key);
+        if (!stored) {
+            http_response_free(req->resp);
+            req->resp = NULL;
+        }
+    } else if (!req->split) {
+        /* Hand the buffer to a GBytes as-is; data stays a view into it */
+        req->resp->body = g_bytes_new_take(req->resp->data, req->resp->size);
     }
+    record_fixture(req, ttfb_us, total_us);
+    request_complete(req);
+}
+
+/* ── Replay ────────────────────────────────────────────────────────── */
+
+/* Serve a replayed request from its fixture, the way engine_finish
+ * would have left it after a live transfer */
+static void replay_finish(HttpRequest *req) {
+    HttpFixture *fx = req->fixture;
+    req->fixture = NULL;
+    engine_release_slot(req);
+    http_response_free(req->resp);
+    req->resp = NULL;
+
+    if (!fx) {
+        if (!flight_cancelled(req))
+            g_warning("HTTP GET failed for %s: no recorded response in %s",
+                      req->url, fixture_dir);
+        request_complete(req);
+        return;
+    }
+
+    g_free(req->etag);
+    g_free(req->last_modified);
+    req->etag = g_strdup(fx->etag);
+    req->last_modified = g_strdup(fx->last_modified);
+
+    HttpResponse *resp = g_new0(HttpResponse, 1);
+    resp->status_code = fx->status;
+    if (req->cache_key) {
+        gsize len = 0;
+        const void *data = g_bytes_get_data(fx->body, &len);
+        if (fx->status == 200 && cache_put(req->cache_key, data, len)) {
+            resp->size = len;
+        } else {
+            g_free(resp);
+            resp = NULL;
+        }
+    } else {
+        resp->body = g_bytes_ref(fx->body);
+        resp->data = (char *)g_bytes_get_data(resp->body, &resp->size);
+    }
+    req->resp = resp;
+    http_fixture_free(fx);
+    request_complete(req);
+}
+
+/* Continue transfers the emulated link held back, once it has room for
+ * them. Returns the delay in ms until the next one may go, or -1. */
+static long engine_release_held(void) {
+    gint64 now = g_get_monotonic_time();
+    long next_ms = -1;
+    for (GList *l = engine_active; l; l = l->next) {
+        HttpRequest *req = l->data;
+        if (!req->shape.held || req->paused || !req->curl) continue;
+        gint64 at = net_shaper_resume_at(&req->shape, now);
+        if (at <= now) {
+            /* Offers the held chunk again, which may hold it once more */
+            req->shape.held = FALSE;
+            curl_easy_pause(req->curl, CURLPAUSE_CONT);
+        } else {
+            long wait_ms = (long)((at - now) / 1000) + 1;
+            if (next_ms < 0 || wait_ms < next_ms) next_ms = wait_ms;
+        }
+    }
+    return next_ms;
+}
+
+/* Finish replayed requests whose time has come. Returns the delay in ms
+ * until the next one is due, or -1. */
+static long engine_collect_replays(void) {
+    if (transport != HTTP_TRANSPORT_REPLAY) return -1;
+
+    gint64 now = g_get_monotonic_time();
+    long next_ms = -1;
+    GList *l = engine_active;
+    while (l) {
+        GList *next = l->next;
+        HttpRequest *req = l->data;
+        if (req->replay_due <= now || flight_cancelled(req)) {
+            if (req->paused) {
+                req->paused = FALSE;
+                engine_paused_count--;
+            }
+            engine_active = g_list_delete_link(engine_active, l);
+            engine_active_count--;
+            replay_finish(req);
+        } else if (!req->paused) {
+            long wait_ms = (long)((req->replay_due - now) / 1000) + 1;
+            if (next_ms < 0 || wait_ms < next_ms) next_ms = wait_ms;
+        }
+        l = next;
+    }
+    return next_ms;
+}
+
+static void engine_collect_done(void) {
+    CURLMsg *msg;
+    int left;
+    while ((msg = curl_multi_info_read(multi, &left))) {
+        if (msg->msg != CURLMSG_DONE) continue;
+        HttpRequest *req = NULL;
+        curl_easy_getinfo(msg->easy_handle, CURLINFO_PRIVATE, (char **)&req);
+        engine_finish(req, msg->data.result);
+    }
+}
+
+/* For http_clear_cache: fail the transfers writing into the cache, then
+ * empty it. Queued ones stay; with their partial files gone they start
+ * over when they run. */
+static void engine_clear(void) {
+    g_mutex_lock(&engine_lock);
+    gboolean wanted = engine_clearing;
+    g_mutex_unlock(&engine_lock);
+    if (!wanted) return;
+
+    engine_note_overlap(g_get_monotonic_time());
+    GList *l = engine_active;
+    while (l) {
+        GList *next = l->next;
+        HttpRequest *req = l->data;
+        if (req->cache_key || req->split) {
+            if (req->curl) {
+                curl_multi_remove_handle(multi, req->curl);
+                pool_release(req->curl);
+                req->curl = NULL;
+            }
+            if (req->paused) {
+                req->paused = FALSE;
+                engine_paused_count--;
+            }
+            engine_active = g_list_delete_link(engine_active, l);
+            engine_active_count--;
+            if (req->writer) {
+                cache_writer_abort(req->writer);
+                req->writer = NULL;
+            }
+            request_fail(req);
+        }
+        l = next;
+    }
+    cache_clear();
+
+    g_mutex_lock(&engine_lock);
+    engine_clearing = FALSE;
+    g_cond_broadcast(&engine_cleared);
+    g_mutex_unlock(&engine_lock);
+}
+
+/* Fail everything still queued or running when the engine stops */
+static void engine_drain(void) {
+    while (engine_active) {
+        HttpRequest *req = engine_active->data;
+        curl_multi_remove_handle(multi, req->curl);
+        pool_release(req->curl);
+        req->curl = NULL;
+        http_response_free(req->resp);
+        req->resp = NULL;
+        engine_active = g_list_delete_link(engine_active, engine_active);
+        request_complete(req);
+    }
+    engine_active_count = 0;
+    engine_paused_count = 0;
+
+    g_mutex_lock(&engine_lock);
+    engine_closed = TRUE;
+    GList *pending = engine_pending.head;
+    g_queue_init(&engine_pending);
+    for (GList *l = pending; l; l = l->next)
+        ((HttpRequest *)l->data)->queued = FALSE;
+    g_mutex_unlock(&engine_lock);
+
+    for (GList *l = pending; l; l = l->next)
+        request_fail(l->data);
+    g_list_free(pending);
+}
+
+static gpointer engine_thread_func(gpointer user_data) {
+    (void)user_data;
+
+    while (!g_atomic_int_get(&engine_quit)) {
+        engine_clear();
+        long retry_ms = engine_start_pending();
+
+        int running = 0;
+        curl_multi_perform(multi, &running);
+        engine_collect_done();
+        long replay_ms = engine_collect_replays();
+        long held_ms = engine_release_held();
+
+        long timeout_ms = HTTP_POLL_MAX_MS;
+        curl_multi_timeout(multi, &timeout_ms);
+        if (timeout_ms < 0 || timeout_ms > HTTP_POLL_MAX_MS)
+            timeout_ms = HTTP_POLL_MAX_MS;
+        if (retry_ms >= 0 && retry_ms < timeout_ms)
+            timeout_ms = retry_ms;
+        if (replay_ms >= 0 && replay_ms < timeout_ms)
+            timeout_ms = replay_ms;
+        if (held_ms >= 0 && held_ms < timeout_ms)
+            timeout_ms = held_ms;
+
+        curl_multi_poll(multi, NULL, 0, (int)timeout_ms, NULL);
+    }
+
+    engine_drain();
+    engine_clear();
+    return NULL;
+}
+
+/* ── Public API ────────────────────────────────────────────────────── */
+
+/* Link state changes arrive on the main loop */
+static void on_network_changed(GNetworkMonitor *monitor, gboolean available,
+                               gpointer user_data) {
+    (void)monitor;
+    (void)user_data;
+    net_monitor_link_changed(available);
+    if (multi) curl_multi_wakeup(multi);
+}
 
-    curl_slist_free_all(header_list);
-    curl_easy_cleanup(curl);
+void http_global_init(void) {
+    curl_global_init(CURL_GLOBAL_DEFAULT);
+
+    share = curl_share_init();
+    if (share) {
+        curl_share_setopt(share, CURLSHOPT_LOCKFUNC, share_lock);
+        curl_share_setopt(share, CURLSHOPT_UNLOCKFUNC, share_unlock);
+        curl_share_setopt(share, CURLSHOPT_SHARE, CURL_LOCK_DATA_DNS);
+        curl_share_setopt(share, CURLSHOPT_SHARE, CURL_LOCK_DATA_SSL_SESSION);
+        curl_share_setopt(share, CURLSHOPT_SHARE, CURL_LOCK_DATA_CONNECT);
+#if LIBCURL_VERSION_NUM >= 0x075800
+        curl_share_setopt(share, CURLSHOPT_SHARE, CURL_LOCK_DATA_HSTS);
+#endif
+        net_persist_load(share, state_dir);
+    }
+
+    multi = curl_multi_init();
+    curl_multi_setopt(multi, CURLMOPT_PIPELINING,
+                      multiplex ? CURLPIPE_MULTIPLEX : CURLPIPE_NOTHING);
+
+    engine_flights = g_hash_table_new(g_str_hash, g_str_equal);
+    engine_warmed = g_hash_table_new_full(g_str_hash, g_str_equal,
+                                          g_free, g_free);
+    engine_quit = FALSE;
+    engine_closed = FALSE;
+    engine_thread = g_thread_create(engine_thread_func, NULL, TRUE, NULL);
+
+    /* Only changes are trusted: some systems report no network while
+     * transfers work fine */
+    engine_link = g_object_ref(g_network_monitor_get_default());
+    g_signal_connect(engine_link, "network-changed",
+                     G_CALLBACK(on_network_changed), NULL);
+}
+
+void http_global_cleanup(void) {
+    if (engine_link) {
+        g_signal_handlers_disconnect_by_func(engine_link,
+                                             G_CALLBACK(on_network_changed),
+                                             NULL);
+        g_object_unref(engine_link);
+        engine_link = NULL;
+    }
+    if (engine_thread) {
+        g_atomic_int_set(&engine_quit, TRUE);
+        curl_multi_wakeup(multi);
+        g_thread_join(engine_thread);
+        engine_thread = NULL;
+    }
+    if (engine_flights) {
+        g_hash_table_destroy(engine_flights);
+        engine_flights = NULL;
+    }
+    if (engine_warmed) {
+        g_hash_table_destroy(engine_warmed);
+        engine_warmed = NULL;
+    }
+    g_free(engine_probe_host);
+    g_free(engine_probe_url);
+    engine_probe_host = NULL;
+    engine_probe_url = NULL;
+    retry_policy_reset();
+    rate_limiter_reset();
+    net_quality_reset();
+    net_monitor_reset();
+    if (multi) {
+        curl_multi_cleanup(multi);
+        multi = NULL;
+    }
+
+    g_mutex_lock(&pool_lock);
+    for (GSList *l = pool_idle; l; l = l->next)
+        curl_easy_cleanup(l->data);
+    g_slist_free(pool_idle);
+    pool_idle = NULL;
+    pool_idle_count = 0;
+    g_mutex_unlock(&pool_lock);
+
+    if (share) {
+        net_persist_save(share);
+        curl_share_cleanup(share);
+        share = NULL;
+    }
+    curl_global_cleanup();
+}
+
+void http_clear_cache(void) {
+    g_mutex_lock(&engine_lock);
+    if (!engine_thread || engine_closed) {
+        g_mutex_unlock(&engine_lock);
+        cache_clear();
+        return;
+    }
+    engine_clearing = TRUE;
+    curl_multi_wakeup(multi);
+    while (engine_clearing)
+        g_cond_wait(&engine_cleared, &engine_lock);
+    g_mutex_unlock(&engine_lock);
+}
+
+void http_set_multiplex(gboolean enable) {
+    multiplex = enable;
+}
+
+void http_set_split(guint parts) {
+    split_parts = parts;
+}
+
+void http_set_ca_file(const char *path) {
+    g_free(ca_file);
+    ca_file = g_strdup(path);
+}
+
+void http_set_state_dir(const char *dir) {
+    g_free(state_dir);
+    state_dir = g_strdup(dir);
+}
+
+void http_set_transport(HttpTransport mode, const char *dir,
+                        gboolean latency) {
+    transport = dir ? mode : HTTP_TRANSPORT_LIVE;
+    g_free(fixture_dir);
+    fixture_dir = g_strdup(dir);
+    replay_latency = latency;
+}
+
+HttpResponse *http_get(const char *url) {
+    return http_get_with_headers(url, NULL);
+}
+
+static char *url_host(const char *url) {
+    char *host = NULL;
+    CURLU *u = curl_url();
+    if (u && curl_url_set(u, CURLUPART_URL, url, 0) == CURLUE_OK) {
+        char *part = NULL;
+        if (curl_url_get(u, CURLUPART_HOST, &part, 0) == CURLUE_OK) {
+            host = g_strdup(part);
+            curl_free(part);
+        }
+    }
+    curl_url_cleanup(u);
+    return host;
+}
+
+static HttpRequest *request_new(const char *url, const char *cache_key,
+                                const char *const *headers) {
+    HttpRequest *req = g_new0(HttpRequest, 1);
+    req->url = g_strdup(url);
+    req->host = url_host(url);
+    req->cache_key = g_strdup(cache_key);
+    req->priority = HTTP_PRIORITY_USER_BLOCKING;
+    req->klass = cache_key ? NET_CLASS_IMAGE : NET_CLASS_COUNT;
+    if (headers) {
+        for (int i = 0; headers[i]; i++)
+            req->headers = curl_slist_append(req->headers, headers[i]);
+    }
+    return req;
+}
+
+/* Run req on the network thread and wait until it has finished */
+static void run_blocking(HttpRequest *req) {
+    if (!engine_thread) return;
+
+    GMutex lock;
+    GCond cond;
+    g_mutex_init(&lock);
+    g_cond_init(&cond);
+    req->wait_lock = &lock;
+    req->wait_cond = &cond;
+
+    engine_submit(req);
+
+    g_mutex_lock(&lock);
+    while (!req->finished)
+        g_cond_wait(&cond, &lock);
+    g_mutex_unlock(&lock);
+
+    g_mutex_clear(&lock);
+    g_cond_clear(&cond);
+    req->wait_lock = NULL;
+    req->wait_cond = NULL;
+}
+
+/* Take the response out of a finished request and free the request */
+static HttpResponse *request_finish(HttpRequest *req) {
+    HttpResponse *resp = req->resp;
+    req->resp = NULL;
+    request_free(req);
     return resp;
 }
 
+HttpResponse *http_get_with_headers(const char *url,
+                                    const char *const *headers) {
+    return http_get_with_priority(url, headers, HTTP_PRIORITY_USER_BLOCKING);
+}
+
+HttpResponse *http_get_with_priority(const char *url,
+                                     const char *const *headers,
+                                     HttpPriority priority) {
+    HttpRequest *req = request_new(url, NULL, headers);
+    req->priority = priority;
+    run_blocking(req);
+    return request_finish(req);
+}
+
+HttpResponse *http_get_cached(const char *url) {
+    /* Fixtures must hold whole bodies, so no 304s while recording */
+    HttpCacheEntry *entry = transport == HTTP_TRANSPORT_LIVE
+                          ? http_cache_lookup(url) : NULL;
+
+    /* Offline: the stored copy is the best there is */
+    if (entry && !net_monitor_online()) {
+        HttpResponse *resp = g_new0(HttpResponse, 1);
+        resp->status_code = 200;
+        resp->body = g_bytes_ref(entry->body);
+        resp->data = (char *)g_bytes_get_data(resp->body, &resp->size);
+        http_cache_entry_free(entry);
+        return resp;
+    }
+
+    HttpRequest *req = request_new(url, NULL, NULL);
+    req->klass = NET_CLASS_HTML;
+    req->want_validators = TRUE;
+    if (entry && entry->etag) {
+        char *h = g_strdup_printf("If-None-Match: %s", entry->etag);
+        req->headers = curl_slist_append(req->headers, h);
+        g_free(h);
+    }
+    if (entry && entry->last_modified) {
+        char *h = g_strdup_printf("If-Modified-Since: %s",
+                                  entry->last_modified);
+        req->headers = curl_slist_append(req->headers, h);
+        g_free(h);
+    }
+
+    run_blocking(req);
+    HttpResponse *resp = req->resp;
+
+    if (resp && resp->status_code == 304 && entry) {
+        /* Unchanged: serve the stored body as if it had been downloaded */
+        http_response_free(resp);
+        resp = g_new0(HttpResponse, 1);
+        resp->status_code = 200;
+        resp->body = g_bytes_ref(entry->body);
+        resp->data = (char *)g_bytes_get_data(resp->body, &resp->size);
+        req->resp = resp;
+    } else if (resp && resp->status_code == 200 && !request_cut_short(req)) {
+        http_cache_store(url, req->etag, req->last_modified,
+                         resp->data, resp->size);
+    }
+
+    http_cache_entry_free(entry);
+    return request_finish(req);
+}
+
+gboolean http_get_to_cache(const char *url, const char *key) {
+    HttpRequest *req = request_new(url, key, NULL);
+    run_blocking(req);
+    HttpResponse *resp = request_finish(req);
+    gboolean ok = resp && resp->status_code == 200;
+    http_response_free(resp);
+    return ok;
+}
+
+static void fetch_async(const char *url, const char *cache_key,
+                        HttpPriority priority, HttpDoneFunc on_done,
+                        gpointer user_data, GCancellable *cancel) {
+    HttpRequest *req = request_new(url, cache_key, NULL);
+    req->priority = priority;
+    req->on_done = on_done;
+    req->user_data = user_data;
+    req->cancel = cancel ? g_object_ref(cancel) : NULL;
+
+    if (!engine_thread) {
+        request_complete(req);
+        return;
+    }
+    engine_submit(req);
+}
+
+void http_fetch_async(const char *url, HttpPriority priority,
+                      HttpDoneFunc on_done, gpointer user_data,
+                      GCancellable *cancel) {
+    fetch_async(url, NULL, priority, on_done, user_data, cancel);
+}
+
+void http_fetch_to_cache_async(const char *url, const char *key,
+                               HttpPriority priority, HttpDoneFunc on_done,
+                               gpointer user_data, GCancellable *cancel) {
+    fetch_async(url, key, priority, on_done, user_data, cancel);
+}
+
+/* scheme://host[:port]/ of url, or NULL if it does not parse */
+static char *url_root(const char *url) {
+    char *root = NULL;
+    CURLU *u = curl_url();
+    if (u && curl_url_set(u, CURLUPART_URL, url, 0) == CURLUE_OK &&
+        curl_url_set(u, CURLUPART_PATH, "/", 0) == CURLUE_OK &&
+        curl_url_set(u, CURLUPART_QUERY, NULL, 0) == CURLUE_OK &&
+        curl_url_set(u, CURLUPART_FRAGMENT, NULL, 0) == CURLUE_OK) {
+        char *part = NULL;
+        if (curl_url_get(u, CURLUPART_URL, &part, 0) == CURLUE_OK) {
+            root = g_strdup(part);
+            curl_free(part);
+        }
+    }
+    curl_url_cleanup(u);
+    return root;
+}
+
+gboolean http_set_priority(const char *url, HttpPriority priority) {
+    g_mutex_lock(&engine_lock);
+    HttpRequest *leader = engine_flights
+                        ? g_hash_table_lookup(engine_flights, url) : NULL;
+    gboolean found = leader && !leader->abandoned;
+    if (found) {
+        /* Never below what a caller attached to it asked for */
+        for (GSList *l = leader->followers; l; l = l->next) {
+            HttpRequest *follower = l->data;
+            if (!request_cancelled(follower))
+                priority = MIN(priority, follower->priority);
+        }
+        if (leader->queued && leader->priority != priority) {
+            g_queue_remove(&engine_pending, leader);
+            leader->priority = priority;
+            g_queue_insert_sorted(&engine_pending, leader,
+                                  pending_compare, NULL);
+        } else {
+            leader->priority = priority;
+        }
+    }
+    g_mutex_unlock(&engine_lock);
+    if (found) curl_multi_wakeup(multi);
+    return found;
+}
+
+void http_warm_up(const char *url) {
+    if (!url || !engine_thread || transport == HTTP_TRANSPORT_REPLAY ||
+        !net_monitor_online())
+        return;
+
+    char *root = url_root(url);
+    if (!root) return;
+    HttpRequest *req = request_new(root, NULL, NULL);
+    g_free(root);
+    if (!req->host) {
+        request_free(req);
+        return;
+    }
+
+    /* A connection opened in the last minute is most likely still alive */
+    gint64 now = g_get_monotonic_time();
+    g_mutex_lock(&engine_lock);
+    gint64 *last = g_hash_table_lookup(engine_warmed, req->host);
+    gboolean fresh = last && now - *last < HTTP_WARM_INTERVAL_US;
+    if (!fresh) {
+        gint64 *stamp = g_new(gint64, 1);
+        *stamp = now;
+        g_hash_table_replace(engine_warmed, g_strdup(req->host), stamp);
+    }
+    g_mutex_unlock(&engine_lock);
+    if (fresh) {
+        request_free(req);
+        return;
+    }
+
+    req->warm_up = TRUE;
+    req->priority = HTTP_PRIORITY_SPECULATIVE;
+    req->klass = NET_CLASS_HTML;
+    engine_submit(req);
+}
+
 void http_response_free(HttpResponse *resp) {
     if (!resp) return;
-    free(resp->data);
+    if (resp->body)
+        g_bytes_unref(resp->body);
+    else
+        g_free(resp->data);
     g_free(resp);
 }
@@ -2,17 +2,114 @@
 #define HTTP_H
 
 #include <glib.h>
+#include <gio/gio.h>
 
 typedef struct {
-    char  *data;
-    size_t size;
-    long   status_code;
+    char   *data;         /* NUL-terminated view of body */
+    size_t  size;
+    long    status_code;
+    GBytes *body;         /* owns data; ref it to keep the bytes alive */
 } HttpResponse;
 
+/* Scheduling classes, most urgent first. A request jumps ahead of every
+ * queued request of a lower class, and background transfers are paused
+ * while anything user-blocking is in flight. */
+typedef enum {
+    HTTP_PRIORITY_USER_BLOCKING,  /* the user is waiting on this right now */
+    HTTP_PRIORITY_NEXT_VISIBLE,   /* what the user will see next */
+    HTTP_PRIORITY_SPECULATIVE,    /* prefetch that may never be looked at */
+    HTTP_PRIORITY_BACKGROUND,     /* housekeeping, e.g. update checks */
+} HttpPriority;
+
+/* Completion callback for http_fetch_async. Runs on the GTK main loop and
+ * takes ownership of resp, which is NULL if the transfer failed. */
+typedef void (*HttpDoneFunc)(HttpResponse *resp, gpointer user_data);
+
 void          http_global_init(void);
 void          http_global_cleanup(void);
+
+/* Empty the cache: transfers writing into it fail, then every entry and
+ * partial download is deleted, revalidation bodies included. Blocks until
+ * done; call from the main loop while the engine runs, or any time it
+ * does not. */
+void          http_clear_cache(void);
+
+/* Transport settings; call before http_global_init. Multiplexing over
+ * HTTP/2 is on by default and can be turned off to compare against
+ * plain HTTP/1.1 connections. Big images the user is about to see are
+ * fetched as up to parts byte ranges at once, each over a connection of
+ * its own, if the server takes ranges; 1 fetches them whole. The CA file
+ * replaces the system store, e.g. for a local test server with its own
+ * certificate. */
+void          http_set_multiplex(gboolean enable);
+void          http_set_split(guint parts);
+void          http_set_ca_file(const char *path);
+
+/* Where TLS sessions, HSTS and alt-svc are kept across runs (see
+ * net_persist); NULL for the app's cache directory. Call before
+ * http_global_init, e.g. to give a benchmark round a cold start of its
+ * own. */
+void          http_set_state_dir(const char *dir);
+
+/* Where responses come from. RECORD fetches live and also stores every
+ * final response (status, headers, body, timings) as a fixture in dir;
+ * REPLAY serves those fixtures without touching the network, taking as
+ * long as the recorded transfer did when latency is set. Requests with
+ * no fixture fail. Either mode bypasses the revalidation cache. */
+typedef enum {
+    HTTP_TRANSPORT_LIVE,
+    HTTP_TRANSPORT_RECORD,
+    HTTP_TRANSPORT_REPLAY,
+} HttpTransport;
+
+void          http_set_transport(HttpTransport mode, const char *dir,
+                                 gboolean latency);
+
+/* Plain GETs of a URL that is already being fetched attach to that
+ * transfer instead of starting another; each caller still gets its own
+ * response (or cache entry) and its own cancellation. */
+
+/* Blocking GET. Runs on the network thread; call from a worker thread.
+ * Someone is waiting on a blocking call, so these are user-blocking. */
 HttpResponse *http_get(const char *url);
 HttpResponse *http_get_with_headers(const char *url, const char *const *headers);
+HttpResponse *http_get_with_priority(const char *url, const char *const *headers,
+                                     HttpPriority priority);
+
+/* Blocking GET for pages that are fetched again and again (source HTML).
+ * The body is stored with its ETag/Last-Modified and revalidated on the
+ * next call; a 304 is returned as a 200 carrying the stored body. */
+HttpResponse *http_get_cached(const char *url);
+
+/* Blocking GET streamed straight into the cache under key, so the body is
+ * never held in memory. TRUE once a 200 response has been stored. */
+gboolean      http_get_to_cache(const char *url, const char *key);
+
+/* Queue a GET on the network thread and return immediately.
+ * If cancel is triggered before the result is dispatched, on_done is
+ * never called, so user_data must not depend on it for cleanup. */
+void          http_fetch_async(const char *url, HttpPriority priority,
+                               HttpDoneFunc on_done, gpointer user_data,
+                               GCancellable *cancel);
+
+/* Async variant of http_get_to_cache. resp carries status_code and the
+ * number of bytes stored, but no data; it is NULL if nothing was stored. */
+void          http_fetch_to_cache_async(const char *url, const char *key,
+                                        HttpPriority priority,
+                                        HttpDoneFunc on_done, gpointer user_data,
+                                        GCancellable *cancel);
+
+/* Move the transfer of url, queued or running, to another class, e.g.
+ * when the user turns to a page that was only being prefetched, or away
+ * from one. It stays at least as urgent as any caller sharing it wants.
+ * FALSE if no plain GET of url is in flight. */
+gboolean      http_set_priority(const char *url, HttpPriority priority);
+
+/* Resolve url's host and open a connection to it (DNS, TCP, TLS) ahead
+ * of requests that are about to need it. Fire and forget; hosts warmed
+ * within the last minute are skipped. */
+void          http_warm_up(const char *url);
+
 void          http_response_free(HttpResponse *resp);
 
 #endif /* HTTP_H */
@@ -0,0 +1,144 @@
+#include "http_cache.h"
+#include "../util/cache.h"
+#include <string.h>
+
+/*
+ * Entries live in the regular cache directory as a single file, so the
+ * validators and the body they describe are always replaced together:
+ *
+ *   MRHC1\n<etag>\n<last-modified>\n<body>
+ *
+ * Empty lines stand for a missing validator.
+ */
+#define HTTP_CACHE_MAGIC "MRHC1\n"
+
+/* Partial download journals sit next to the entry's .part file:
+ *
+ *   MRPJ1\n<validator>\n
+ */
+#define HTTP_PARTIAL_MAGIC "MRPJ1\n"
+
+static char *entry_key(const char *url) {
+    char *id = g_strconcat("http-cache:", url, NULL);
+    char *key = cache_key_from_url(id);
+    g_free(id);
+    return key;
+}
+
+/* Return a copy of the line starting at *pos and advance past it */
+static char *take_line(const char **pos, const char *end) {
+    const char *nl = memchr(*pos, '\n', (size_t)(end - *pos));
+    if (!nl) return NULL;
+    char *line = g_strndup(*pos, (gsize)(nl - *pos));
+    *pos = nl + 1;
+    return line;
+}
+
+HttpCacheEntry *http_cache_lookup(const char *url) {
+    char *key = entry_key(url);
+    size_t len = 0;
+    char *contents = cache_get(key, &len);
+    g_free(key);
+    if (!contents) return NULL;
+
+    size_t magic_len = strlen(HTTP_CACHE_MAGIC);
+    if (len < magic_len || memcmp(contents, HTTP_CACHE_MAGIC, magic_len) != 0) {
+        g_free(contents);
+        return NULL;
+    }
+
+    const char *pos = contents + magic_len;
+    const char *end = contents + len;
+    char *etag = take_line(&pos, end);
+    char *last_modified = etag ? take_line(&pos, end) : NULL;
+    if (!last_modified) {
+        g_free(etag);
+        g_free(contents);
+        return NULL;
+    }
+
+    HttpCacheEntry *entry = g_new0(HttpCacheEntry, 1);
+    if (*etag) entry->etag = etag; else g_free(etag);
+    if (*last_modified) entry->last_modified = last_modified;
+    else g_free(last_modified);
+
+    /* cache_get NUL-terminates, so the body slice is NUL-terminated too */
+    GBytes *whole = g_bytes_new_take(contents, len);
+    entry->body = g_bytes_new_from_bytes(whole, (gsize)(pos - contents),
+                                         (gsize)(end - pos));
+    g_bytes_unref(whole);
+    return entry;
+}
+
+void http_cache_store(const char *url, const char *etag,
+                      const char *last_modified,
+                      const char *data, size_t size) {
+    if (!etag && !last_modified) return;
+
+    char *key = entry_key(url);
+    CacheWriter *w = cache_writer_new(key);
+    g_free(key);
+    if (!w) return;
+
+    char *header = g_strdup_printf("%s%s\n%s\n", HTTP_CACHE_MAGIC,
+                                   etag ? etag : "",
+                                   last_modified ? last_modified : "");
+    gboolean ok = cache_writer_write(w, header, strlen(header)) &&
+                  (size == 0 || cache_writer_write(w, data, size));
+    g_free(header);
+
+    if (ok)
+        cache_writer_commit(w);
+    else
+        cache_writer_abort(w);
+}
+
+void http_cache_entry_free(HttpCacheEntry *entry) {
+    if (!entry) return;
+    g_free(entry->etag);
+    g_free(entry->last_modified);
+    if (entry->body) g_bytes_unref(entry->body);
+    g_free(entry);
+}
+
+/* ── Partial downloads ─────────────────────────────────────────────── */
+
+static char *journal_key(const char *key) {
+    return g_strconcat(key, ".journal", NULL);
+}
+
+char *http_cache_partial_validator(const char *key) {
+    char *jkey = journal_key(key);
+    size_t len = 0;
+    char *contents = cache_get(jkey, &len);
+    g_free(jkey);
+    if (!contents) return NULL;
+
+    char *validator = NULL;
+    size_t magic_len = strlen(HTTP_PARTIAL_MAGIC);
+    if (len > magic_len &&
+        memcmp(contents, HTTP_PARTIAL_MAGIC, magic_len) == 0) {
+        const char *pos = contents + magic_len;
+        validator = take_line(&pos, contents + len);
+        if (validator && !validator[0]) {
+            g_free(validator);
+            validator = NULL;
+        }
+    }
+    g_free(contents);
+    return validator;
+}
+
+void http_cache_partial_save(const char *key, const char *validator) {
+    char *jkey = journal_key(key);
+    char *contents = g_strdup_printf("%s%s\n", HTTP_PARTIAL_MAGIC, validator);
+    cache_put(jkey, contents, strlen(contents));
+    g_free(contents);
+    g_free(jkey);
+}
+
+void http_cache_partial_clear(const char *key) {
+    char *jkey = journal_key(key);
+    cache_remove(jkey);
+    g_free(jkey);
+}
@@ -0,0 +1,31 @@
+#ifndef HTTP_CACHE_H
+#define HTTP_CACHE_H
+
+#include <glib.h>
+
+/* A previously fetched response kept for conditional revalidation. */
+typedef struct {
+    char   *etag;            /* NULL if the server sent none */
+    char   *last_modified;   /* NULL if the server sent none */
+    GBytes *body;            /* NUL-terminated */
+} HttpCacheEntry;
+
+/* Look up the stored response for url. Returns NULL if there is none. */
+HttpCacheEntry *http_cache_lookup(const char *url);
+
+/* Store a 200 response body with its validators. Does nothing when both
+ * validators are NULL, since such a response can never be revalidated. */
+void            http_cache_store(const char *url, const char *etag,
+                                 const char *last_modified,
+                                 const char *data, size_t size);
+
+void            http_cache_entry_free(HttpCacheEntry *entry);
+
+/* Journal for a partly downloaded cache entry: the validator (ETag, or
+ * Last-Modified) of the response the partial body came from, so it can be
+ * resumed with If-Range. Returns NULL if there is no usable journal. */
+char           *http_cache_partial_validator(const char *key);
+void            http_cache_partial_save(const char *key, const char *validator);
+void            http_cache_partial_clear(const char *key);
+
+#endif /* HTTP_CACHE_H */
@@ -0,0 +1,140 @@
+#include "http_fixture.h"
+#include "../util/cache.h"
+#include <glib/gstdio.h>
+#include <string.h>
+
+/*
+ * Each fixture is two files named after a hash of the URL:
+ *
+ *   <hash>.body   the response body, byte for byte
+ *   <hash>.meta   key file with the URL, status, headers and timings
+ *
+ * The body is written first, so a .meta file always has its body. Both
+ * are plain files that can be inspected or edited by hand.
+ */
+#define FIXTURE_GROUP_REQUEST  "request"
+#define FIXTURE_GROUP_RESPONSE "response"
+
+static char *fixture_path(const char *dir, const char *url,
+                          const char *suffix) {
+    char *hash = cache_key_from_url(url);
+    char *name = g_strconcat(hash, suffix, NULL);
+    char *path = g_build_filename(dir, name, NULL);
+    g_free(name);
+    g_free(hash);
+    return path;
+}
+
+/* Empty strings in the key file stand for a missing value */
+static char *key_string(GKeyFile *kf, const char *key) {
+    char *value = g_key_file_get_string(kf, FIXTURE_GROUP_RESPONSE, key, NULL);
+    if (value && !*value) {
+        g_free(value);
+        value = NULL;
+    }
+    return value;
+}
+
+HttpFixture *http_fixture_load(const char *dir, const char *url) {
+    char *meta_path = fixture_path(dir, url, ".meta");
+    GKeyFile *kf = g_key_file_new();
+    gboolean loaded = g_key_file_load_from_file(kf, meta_path,
+                                                G_KEY_FILE_NONE, NULL);
+    g_free(meta_path);
+    if (!loaded) {
+        g_key_file_free(kf);
+        return NULL;
+    }
+
+    /* A hash collision, or a fixture copied from another URL */
+    char *recorded_url = g_key_file_get_string(kf, FIXTURE_GROUP_REQUEST,
+                                               "url", NULL);
+    gboolean match = g_strcmp0(recorded_url, url) == 0;
+    g_free(recorded_url);
+
+    char *body_path = fixture_path(dir, url, ".body");
+    char *contents = NULL;
+    gsize len = 0;
+    if (match)
+        match = g_file_get_contents(body_path, &contents, &len, NULL);
+    g_free(body_path);
+    if (!match) {
+        g_key_file_free(kf);
+        return NULL;
+    }
+
+    HttpFixture *fx = g_new0(HttpFixture, 1);
+    fx->status = (long)g_key_file_get_integer(kf, FIXTURE_GROUP_RESPONSE,
+                                              "status", NULL);
+    fx->etag = key_string(kf, "etag");
+    fx->last_modified = key_string(kf, "last-modified");
+    fx->ttfb_us = g_key_file_get_int64(kf, FIXTURE_GROUP_RESPONSE,
+                                       "ttfb-us", NULL);
+    fx->total_us = g_key_file_get_int64(kf, FIXTURE_GROUP_RESPONSE,
+                                        "total-us", NULL);
+
+    char **lines = g_key_file_get_string_list(kf, FIXTURE_GROUP_RESPONSE,
+                                              "headers", NULL, NULL);
+    if (lines) fx->headers = g_strjoinv("\n", lines);
+    g_strfreev(lines);
+
+    /* g_file_get_contents NUL-terminates past len */
+    fx->body = g_bytes_new_take(contents, len);
+    g_key_file_free(kf);
+    return fx;
+}
+
+gboolean http_fixture_save(const char *dir, const char *url,
+                           const char *const *request_headers,
+                           const HttpFixture *fx) {
+    if (g_mkdir_with_parents(dir, 0755) != 0) {
+        g_warning("Cannot create fixture directory %s", dir);
+        return FALSE;
+    }
+
+    gsize len = 0;
+    const char *data = fx->body ? g_bytes_get_data(fx->body, &len) : NULL;
+    char *body_path = fixture_path(dir, url, ".body");
+    gboolean ok = g_file_set_contents(body_path, data ? data : "",
+                                      (gssize)len, NULL);
+    g_free(body_path);
+    if (!ok) return FALSE;
+
+    GKeyFile *kf = g_key_file_new();
+    g_key_file_set_string(kf, FIXTURE_GROUP_REQUEST, "url", url);
+    if (request_headers && request_headers[0]) {
+        g_key_file_set_string_list(kf, FIXTURE_GROUP_REQUEST, "headers",
+                                   request_headers,
+                                   g_strv_length((char **)request_headers));
+    }
+    g_key_file_set_integer(kf, FIXTURE_GROUP_RESPONSE, "status",
+                           (gint)fx->status);
+    g_key_file_set_string(kf, FIXTURE_GROUP_RESPONSE, "etag",
+                          fx->etag ? fx->etag : "");
+    g_key_file_set_string(kf, FIXTURE_GROUP_RESPONSE, "last-modified",
+                          fx->last_modified ? fx->last_modified : "");
+    if (fx->headers) {
+        char **lines = g_strsplit(fx->headers, "\n", -1);
+        g_key_file_set_string_list(kf, FIXTURE_GROUP_RESPONSE, "headers",
+                                   (const char *const *)lines,
+                                   g_strv_length(lines));
+        g_strfreev(lines);
+    }
+    g_key_file_set_int64(kf, FIXTURE_GROUP_RESPONSE, "ttfb-us", fx->ttfb_us);
+    g_key_file_set_int64(kf, FIXTURE_GROUP_RESPONSE, "total-us", fx->total_us);
+
+    char *meta_path = fixture_path(dir, url, ".meta");
+    ok = g_key_file_save_to_file(kf, meta_path, NULL);
+    g_free(meta_path);
+    g_key_file_free(kf);
+    return ok;
+}
+
+void http_fixture_free(HttpFixture *fx) {
+    if (!fx) return;
+    g_free(fx->etag);
+    g_free(fx->last_modified);
+    g_free(fx->headers);
+    if (fx->body) g_bytes_unref(fx->body);
+    g_free(fx);
+}
@@ -0,0 +1,30 @@
+#ifndef HTTP_FIXTURE_H
+#define HTTP_FIXTURE_H
+
+#include <glib.h>
+
+/* A recorded response, as the record transport saw it and the replay
+ * transport serves it back. */
+typedef struct {
+    long    status;
+    char   *etag;            /* NULL if the server sent none */
+    char   *last_modified;   /* NULL if the server sent none */
+    char   *headers;         /* raw response header lines, '\n'-separated */
+    gint64  ttfb_us;         /* request sent → first byte */
+    gint64  total_us;        /* whole transfer */
+    GBytes *body;            /* NUL-terminated */
+} HttpFixture;
+
+/* Load the fixture recorded for url in dir. Returns NULL if there is none. */
+HttpFixture *http_fixture_load(const char *dir, const char *url);
+
+/* Store fx as the fixture for url in dir, replacing any earlier one.
+ * request_headers (NULL-terminated, may be NULL) are kept for reference
+ * only; replay matches on the URL. */
+gboolean     http_fixture_save(const char *dir, const char *url,
+                               const char *const *request_headers,
+                               const HttpFixture *fx);
+
+void         http_fixture_free(HttpFixture *fx);
+
+#endif /* HTTP_FIXTURE_H */
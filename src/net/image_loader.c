@@ -3,11 +3,11 @@
 #include "../util/cache.h"
 #include <string.h>
 
-static GdkPixbuf *scale_pixbuf(GdkPixbuf *orig, int max_w, int max_h) {
-    if (max_w <= 0 && max_h <= 0) return g_object_ref(orig);
-
-    int w = gdk_pixbuf_get_width(orig);
-    int h = gdk_pixbuf_get_height(orig);
+/* Size of a w x h image scaled to fit within max_w x max_h (either may be
+ * 0 for no limit); FALSE if it already does exactly */
+static gboolean fit_size(int w, int h, int max_w, int max_h,
+                         int *new_w, int *new_h) {
+    if (max_w <= 0 && max_h <= 0) return FALSE;
 
     if (max_w <= 0) max_w = w;
     if (max_h <= 0) max_h = h;
@@ -17,44 +17,86 @@ static GdkPixbuf *scale_pixbuf(GdkPixbuf *orig, int max_w, int max_h) {
     double scale = (scale_x < scale_y) ? scale_x : scale_y;
 
     /* Allow scaling up or down to fit the display */
-    if (scale == 1.0) return g_object_ref(orig);
+    if (scale == 1.0) return FALSE;
 
-    int new_w = (int)(w * scale);
-    int new_h = (int)(h * scale);
-    if (new_w < 1) new_w = 1;
-    if (new_h < 1) new_h = 1;
+    *new_w = (int)(w * scale);
+    *new_h = (int)(h * scale);
+    if (*new_w < 1) *new_w = 1;
+    if (*new_h < 1) *new_h = 1;
+    return *new_w != w || *new_h != h;
+}
+
+static GdkPixbuf *scale_pixbuf(GdkPixbuf *orig, int max_w, int max_h) {
+    int new_w, new_h;
+    if (!fit_size(gdk_pixbuf_get_width(orig), gdk_pixbuf_get_height(orig),
+                  max_w, max_h, &new_w, &new_h))
+        return g_object_ref(orig);
 
     return gdk_pixbuf_scale_simple(orig, new_w, new_h, GDK_INTERP_BILINEAR);
 }
 
-GdkPixbuf *image_loader_from_bytes(const char *data, size_t len,
-                                   int max_width, int max_height) {
-    GInputStream *stream = g_memory_input_stream_new_from_data(
-        g_memdup(data, len), len, g_free);
+typedef struct {
+    int max_width;
+    int max_height;
+} DecodeSize;
+
+/* Asking for the final size up front lets the JPEG loader decode at the
+ * smallest 1/2, 1/4 or 1/8 reduction that is still at least that big,
+ * so a 1600px page is never decoded at full size just to be shrunk */
+static void on_size_prepared(GdkPixbufLoader *loader, int width, int height,
+                             gpointer user_data) {
+    DecodeSize *size = user_data;
+    int new_w, new_h;
+    if (fit_size(width, height, size->max_width, size->max_height,
+                 &new_w, &new_h))
+        gdk_pixbuf_loader_set_size(loader, new_w, new_h);
+}
+
+static GdkPixbuf *decode_data(const guchar *data, gsize len,
+                              int max_width, int max_height) {
+    DecodeSize size = { max_width, max_height };
+    GdkPixbufLoader *loader = gdk_pixbuf_loader_new();
+    g_signal_connect(loader, "size-prepared",
+                     G_CALLBACK(on_size_prepared), &size);
+
     GError *err = NULL;
-    GdkPixbuf *orig = gdk_pixbuf_new_from_stream(stream, NULL, &err);
-    g_object_unref(stream);
+    gboolean ok = gdk_pixbuf_loader_write(loader, data, len, &err);
+    /* Always close, or the loader complains when it is finalized */
+    if (!gdk_pixbuf_loader_close(loader, ok ? &err : NULL)) ok = FALSE;
 
+    GdkPixbuf *orig = ok ? gdk_pixbuf_loader_get_pixbuf(loader) : NULL;
     if (!orig) {
         g_warning("Failed to decode image: %s", err ? err->message : "unknown");
         g_clear_error(&err);
+        g_object_unref(loader);
         return NULL;
     }
 
+    /* Loaders that cannot scale while decoding leave it to us */
     GdkPixbuf *scaled = scale_pixbuf(orig, max_width, max_height);
-    g_object_unref(orig);
+    g_object_unref(loader);
     return scaled;
 }
 
+GdkPixbuf *image_loader_from_bytes(const char *data, size_t len,
+                                   int max_width, int max_height) {
+    return decode_data((const guchar *)data, len, max_width, max_height);
+}
+
+GdkPixbuf *image_loader_from_gbytes(GBytes *bytes,
+                                    int max_width, int max_height) {
+    gsize len = 0;
+    const guchar *data = g_bytes_get_data(bytes, &len);
+    return decode_data(data, len, max_width, max_height);
+}
+
 GdkPixbuf *image_loader_fetch(const char *url, int max_width, int max_height) {
     /* Check cache first */
     char *key = cache_key_from_url(url);
-    size_t cached_len = 0;
-    void *cached = cache_get(key, &cached_len);
+    GBytes *cached = cache_get_bytes(key);
     if (cached) {
-        GdkPixbuf *pb = image_loader_from_bytes(cached, cached_len,
-                                                 max_width, max_height);
-        g_free(cached);
+        GdkPixbuf *pb = image_loader_from_gbytes(cached, max_width, max_height);
+        g_bytes_unref(cached);
         g_free(key);
         return pb;
     }
@@ -70,54 +112,133 @@ GdkPixbuf *image_loader_fetch(const char *url, int max_width, int max_height) {
     cache_put(key, resp->data, resp->size);
     g_free(key);
 
-    GdkPixbuf *pb = image_loader_from_bytes(resp->data, resp->size,
-                                            max_width, max_height);
+    GdkPixbuf *pb = image_loader_from_gbytes(resp->body,
+                                             max_width, max_height);
     http_response_free(resp);
     return pb;
 }
 
-GdkPixbuf *image_loader_to_grayscale(GdkPixbuf *src) {
+GrayImage *image_loader_to_gray(GdkPixbuf *src, const guint8 *lut) {
     if (!src) return NULL;
 
     int width = gdk_pixbuf_get_width(src);
     int height = gdk_pixbuf_get_height(src);
+    GrayImage *dest = gray_image_new(width, height);
+    if (!dest) return NULL;
+
     int n_channels = gdk_pixbuf_get_n_channels(src);
-    int rowstride = gdk_pixbuf_get_rowstride(src);
-    gboolean has_alpha = gdk_pixbuf_get_has_alpha(src);
-
-    GdkPixbuf *dest = gdk_pixbuf_copy(src);
-    guchar *src_pixels = gdk_pixbuf_get_pixels(src);
-    guchar *dst_pixels = gdk_pixbuf_get_pixels(dest);
-
-    for (int y = 0; y < height; y++) {
-        guchar *src_row = src_pixels + y * rowstride;
-        guchar *dst_row = dst_pixels + y * rowstride;
-        for (int x = 0; x < width; x++) {
-            int offset = x * n_channels;
-            guchar r = src_row[offset];
-            guchar g = src_row[offset + 1];
-            guchar b = src_row[offset + 2];
-            /* Luminosity method */
-            guchar gray = (guchar)(0.299 * r + 0.587 * g + 0.114 * b);
-            dst_row[offset] = gray;
-            dst_row[offset + 1] = gray;
-            dst_row[offset + 2] = gray;
-            if (has_alpha)
-                dst_row[offset + 3] = src_row[offset + 3];
-        }
-    }
+    int src_stride = gdk_pixbuf_get_rowstride(src);
+    const guchar *src_pixels = gdk_pixbuf_get_pixels(src);
+
+    for (int y = 0; y < height; y++)
+        grayscale_row(src_pixels + y * src_stride, n_channels,
+                      dest->pixels + y * dest->rowstride, 1, width, lut);
     return dest;
 }
 
-GdkPixbuf *image_loader_fetch_processed(const char *url, int max_width,
-                                        int max_height, gboolean grayscale) {
+/* Tone curve for every rendered page; set once at startup */
+static guint8   tone_lut[256];
+static gboolean tone_on = FALSE;
+
+void image_loader_set_tone(double gamma, double contrast) {
+    tone_on = gamma != 1.0 || contrast != 1.0;
+    if (tone_on)
+        grayscale_tone_lut(tone_lut, gamma, contrast);
+}
+
+GrayImage *image_loader_fetch_gray(const char *url, int max_width,
+                                   int max_height) {
     GdkPixbuf *pb = image_loader_fetch(url, max_width, max_height);
     if (!pb) return NULL;
 
-    if (grayscale) {
-        GdkPixbuf *gray = image_loader_to_grayscale(pb);
-        g_object_unref(pb);
-        return gray;
+    GrayImage *gray = image_loader_to_gray(pb, tone_on ? tone_lut : NULL);
+    g_object_unref(pb);
+    return gray;
+}
+
+/* ── Async rendering ───────────────────────────────────────────────── */
+
+typedef struct {
+    char             *url;
+    int               max_width;
+    int               max_height;
+    GdkPixbufRotation rotation;
+    ImageRenderFunc   on_done;
+    gpointer          user_data;
+    GCancellable     *cancel;
+    GrayImage        *result;
+} RenderJob;
+
+/* One worker: on a single core, decodes side by side only slow each
+ * other down */
+static GThreadPool *render_pool = NULL;
+static gint         render_quit = FALSE;
+
+static void render_job_free(RenderJob *job) {
+    gray_image_unref(job->result);
+    if (job->cancel) g_object_unref(job->cancel);
+    g_free(job->url);
+    g_free(job);
+}
+
+static gboolean render_dispatch(gpointer user_data) {
+    RenderJob *job = user_data;
+    if (!g_cancellable_is_cancelled(job->cancel)) {
+        GrayImage *image = job->result;
+        job->result = NULL;
+        job->on_done(image, job->user_data);
     }
-    return pb;
+    render_job_free(job);
+    return FALSE;
+}
+
+static void render_worker(gpointer job_data, gpointer pool_data) {
+    (void)pool_data;
+    RenderJob *job = job_data;
+
+    /* Superseded while it waited in line, or shutting down */
+    if (g_cancellable_is_cancelled(job->cancel) ||
+        g_atomic_int_get(&render_quit)) {
+        render_job_free(job);
+        return;
+    }
+
+    job->result = image_loader_fetch_gray(job->url, job->max_width,
+                                          job->max_height);
+    if (job->result && job->rotation != GDK_PIXBUF_ROTATE_NONE) {
+        GrayImage *rotated = gray_image_rotate(job->result,
+                                               (int)job->rotation);
+        gray_image_unref(job->result);
+        job->result = rotated;
+    }
+    g_idle_add(render_dispatch, job);
+}
+
+void image_loader_render_async(const char *url, int max_width, int max_height,
+                               GdkPixbufRotation rotation,
+                               ImageRenderFunc on_done, gpointer user_data,
+                               GCancellable *cancel) {
+    RenderJob *job = g_new0(RenderJob, 1);
+    job->url = g_strdup(url);
+    job->max_width = max_width;
+    job->max_height = max_height;
+    job->rotation = rotation;
+    job->on_done = on_done;
+    job->user_data = user_data;
+    job->cancel = cancel ? g_object_ref(cancel) : NULL;
+
+    if (!render_pool)
+        render_pool = g_thread_pool_new(render_worker, NULL, 1, FALSE, NULL);
+    if (!render_pool) {
+        g_idle_add(render_dispatch, job);
+        return;
+    }
+    g_thread_pool_push(render_pool, job, NULL);
+}
+
+void image_loader_shutdown(void) {
+    if (!render_pool) return;
+    g_atomic_int_set(&render_quit, TRUE);
+    g_thread_pool_free(render_pool, FALSE, TRUE);
+    render_pool = NULL;
 }
@@ -2,20 +2,53 @@
 #define IMAGE_LOADER_H
 
 #include <gdk-pixbuf/gdk-pixbuf.h>
+#include "../util/grayscale.h"
 
 /* Download an image from url and return as a GdkPixbuf.
  * If max_width/max_height > 0, scale to fit within those bounds. */
 GdkPixbuf *image_loader_fetch(const char *url, int max_width, int max_height);
 
-/* Load a pixbuf from raw bytes. */
+/* Load a pixbuf from raw bytes. The data is decoded in place, not copied. */
 GdkPixbuf *image_loader_from_bytes(const char *data, size_t len,
                                    int max_width, int max_height);
 
-/* Convert a pixbuf to grayscale using luminosity method. Returns new pixbuf. */
-GdkPixbuf *image_loader_to_grayscale(GdkPixbuf *src);
+/* Load a pixbuf from a GBytes buffer (e.g. HttpResponse body or a mapped
+ * cache entry) without copying it. */
+GdkPixbuf *image_loader_from_gbytes(GBytes *bytes,
+                                    int max_width, int max_height);
 
-/* Fetch image, scale, and optionally convert to grayscale in one call. */
-GdkPixbuf *image_loader_fetch_processed(const char *url, int max_width,
-                                        int max_height, gboolean grayscale);
+/* Convert a pixbuf to an 8-bit gray image, passing every value through
+ * lut if it is not NULL. */
+GrayImage *image_loader_to_gray(GdkPixbuf *src, const guint8 *lut);
+
+/* Gamma and contrast applied to every page image_loader_fetch_gray makes
+ * (see grayscale_tone_lut); 1.0 and 1.0, the default, leave pages as they
+ * are. Call before the first render. */
+void image_loader_set_tone(double gamma, double contrast);
+
+/* Fetch image, scale, convert it to an 8-bit gray image and apply the
+ * tone curve. */
+GrayImage *image_loader_fetch_gray(const char *url, int max_width,
+                                   int max_height);
+
+/* Completion callback for image_loader_render_async. Runs on the GTK main
+ * loop and takes ownership of image, which is NULL if it failed. */
+typedef void (*ImageRenderFunc)(GrayImage *image, gpointer user_data);
+
+/* image_loader_fetch_gray plus a rotation, done on a worker thread so the
+ * main loop stays responsive. Call from the main loop. Renders run one at
+ * a time, oldest first; one whose cancel is triggered before its result
+ * is dispatched is skipped and on_done is never called, so a caller
+ * drops out-of-date pages by cancelling them. */
+void image_loader_render_async(const char *url, int max_width, int max_height,
+                               GdkPixbufRotation rotation,
+                               ImageRenderFunc on_done, gpointer user_data,
+                               GCancellable *cancel);
+
+/* Wait for the render in progress, if any, and drop the ones queued
+ * behind it without calling them back. Call once the HTTP engine has
+ * stopped (http_global_cleanup), so a render waiting on the network
+ * fails at once, and before cache_shutdown. */
+void image_loader_shutdown(void);
 
 #endif /* IMAGE_LOADER_H */
@@ -0,0 +1,96 @@
+#include "net_monitor.h"
+
+#define MONITOR_OFFLINE_AFTER  2     /* unreachable results in a row */
+#define MONITOR_PROBE_MIN_US   (5 * G_USEC_PER_SEC)
+#define MONITOR_PROBE_MAX_US   (60 * G_USEC_PER_SEC)
+
+static GMutex   monitor_lock;
+static gboolean online = TRUE;
+static int      unreachable = 0;       /* consecutive results */
+static gint64   probe_at = 0;          /* next probe, while offline */
+static gint64   probe_interval = MONITOR_PROBE_MIN_US;
+
+/* Caller holds monitor_lock */
+static void set_online(gboolean now_online) {
+    if (online == now_online) return;
+    online = now_online;
+    unreachable = 0;
+    probe_interval = MONITOR_PROBE_MIN_US;
+    /* Probe straight away: if only one server is down, the last one
+     * that answered brings us back before anyone notices */
+    probe_at = online ? 0 : g_get_monotonic_time();
+    if (online)
+        g_message("Network is reachable again");
+    else
+        g_message("Network unreachable; failing uncached requests until it returns");
+}
+
+void net_monitor_report(CURLcode res, gboolean heard_back) {
+    gboolean reached = res == CURLE_OK || heard_back;
+    gboolean lost = FALSE;
+    if (!reached) {
+        switch (res) {
+        case CURLE_COULDNT_RESOLVE_HOST:
+        case CURLE_COULDNT_RESOLVE_PROXY:
+        case CURLE_COULDNT_CONNECT:
+        case CURLE_OPERATION_TIMEDOUT:
+        case CURLE_SEND_ERROR:
+        case CURLE_RECV_ERROR:
+        case CURLE_GOT_NOTHING:
+            lost = TRUE;
+            break;
+        default:
+            return;     /* cancelled, bad URL, disk error, ... */
+        }
+    }
+
+    g_mutex_lock(&monitor_lock);
+    if (reached) {
+        unreachable = 0;
+        set_online(TRUE);
+    } else if (lost && online && ++unreachable >= MONITOR_OFFLINE_AFTER) {
+        set_online(FALSE);
+    }
+    g_mutex_unlock(&monitor_lock);
+}
+
+void net_monitor_link_changed(gboolean available) {
+    g_mutex_lock(&monitor_lock);
+    if (!available) {
+        set_online(FALSE);
+    } else if (!online) {
+        /* Worth checking straight away rather than at the next probe */
+        probe_interval = MONITOR_PROBE_MIN_US;
+        probe_at = g_get_monotonic_time();
+    }
+    g_mutex_unlock(&monitor_lock);
+}
+
+gboolean net_monitor_online(void) {
+    g_mutex_lock(&monitor_lock);
+    gboolean up = online;
+    g_mutex_unlock(&monitor_lock);
+    return up;
+}
+
+gboolean net_monitor_probe_due(gint64 now, gint64 *next_at) {
+    gboolean due = FALSE;
+    g_mutex_lock(&monitor_lock);
+    if (!online && now >= probe_at) {
+        due = TRUE;
+        probe_at = now + probe_interval;
+        probe_interval = MIN(probe_interval * 2, MONITOR_PROBE_MAX_US);
+    }
+    *next_at = online ? 0 : probe_at;
+    g_mutex_unlock(&monitor_lock);
+    return due;
+}
+
+void net_monitor_reset(void) {
+    g_mutex_lock(&monitor_lock);
+    online = TRUE;
+    unreachable = 0;
+    probe_at = 0;
+    probe_interval = MONITOR_PROBE_MIN_US;
+    g_mutex_unlock(&monitor_lock);
+}
@@ -0,0 +1,28 @@
+#ifndef NET_MONITOR_H
+#define NET_MONITOR_H
+
+#include <glib.h>
+#include <curl/curl.h>
+
+/* Whether the network is reachable at all, judged from how transfers end
+ * and from the system's own link state. A couple of transfers that could
+ * not reach any server switch to offline; anything that gets an answer,
+ * including a reachability probe, switches back. Thread-safe. */
+
+/* Outcome of a transfer attempt; heard_back is TRUE if any response
+ * bytes arrived. Cancelled and other ambiguous results are ignored. */
+void     net_monitor_report(CURLcode res, gboolean heard_back);
+
+/* The system link went up or down (GNetworkMonitor). */
+void     net_monitor_link_changed(gboolean available);
+
+gboolean net_monitor_online(void);
+
+/* While offline: TRUE if a probe should be sent now, after which the
+ * next one is scheduled further out. *next_at is when the next probe is
+ * due (monotonic µs), or 0 when online. */
+gboolean net_monitor_probe_due(gint64 now, gint64 *next_at);
+
+void     net_monitor_reset(void);
+
+#endif /* NET_MONITOR_H */
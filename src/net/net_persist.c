@@ -0,0 +1,276 @@
+#include "net_persist.h"
+#include <glib/gstdio.h>
+#include <string.h>
+#include <time.h>
+
+/*
+ * Three files in the cache directory:
+ *
+ *   tls-sessions   key file, one group per session ticket (base64)
+ *   hsts.txt       curl's own HSTS cache format
+ *   alt-svc.txt    curl's own alt-svc cache format
+ *
+ * Session tickets can only be exported from libcurl 8.12 on, and only
+ * when it was built with SSL session export; otherwise the file is never
+ * written and every launch starts with full handshakes, as before.
+ *
+ * HSTS lives in the share (libcurl 7.88 on), so every handle writes the
+ * same complete list. Alt-svc cannot be shared: each handle gets a copy
+ * of the file of its own, "alt-svc-<n>.txt", and the copies are merged
+ * back into alt-svc.txt once, when the engine stops (or, after a crash,
+ * when it next starts).
+ */
+#define PERSIST_SESSIONS_MAX 64
+#define PERSIST_GROUP_PREFIX "session-"
+#define ALTSVC_COPY_PREFIX   "alt-svc-"
+
+static char *base_dir = NULL;
+static char *sessions_path = NULL;
+static char *hsts_path = NULL;
+static char *altsvc_path = NULL;
+static gint  altsvc_copies = 0;
+
+/* ── TLS sessions ──────────────────────────────────────────────────── */
+
+#if LIBCURL_VERSION_NUM >= 0x080c00
+
+typedef struct {
+    GKeyFile *kf;
+    int       count;
+} SessionExport;
+
+static CURLcode export_session(CURL *handle, void *userp,
+                               const char *session_key,
+                               const unsigned char *shmac, size_t shmac_len,
+                               const unsigned char *sdata, size_t sdata_len,
+                               curl_off_t valid_until, int ietf_tls_id,
+                               const char *alpn, size_t earlydata_max) {
+    (void)handle; (void)session_key; (void)ietf_tls_id;
+    (void)alpn; (void)earlydata_max;
+    SessionExport *ex = userp;
+
+    /* Tickets without a salted peer hash cannot be matched on import */
+    if (!shmac || !shmac_len || ex->count >= PERSIST_SESSIONS_MAX)
+        return CURLE_OK;
+    if (valid_until > 0 && valid_until <= (curl_off_t)time(NULL))
+        return CURLE_OK;
+
+    char *group = g_strdup_printf(PERSIST_GROUP_PREFIX "%d", ex->count++);
+    char *hmac = g_base64_encode(shmac, shmac_len);
+    char *data = g_base64_encode(sdata, sdata_len);
+    g_key_file_set_string(ex->kf, group, "shmac", hmac);
+    g_key_file_set_string(ex->kf, group, "data", data);
+    g_key_file_set_int64(ex->kf, group, "valid-until", (gint64)valid_until);
+    g_free(data);
+    g_free(hmac);
+    g_free(group);
+    return CURLE_OK;
+}
+
+static void sessions_load(CURLSH *share) {
+    GKeyFile *kf = g_key_file_new();
+    if (!g_key_file_load_from_file(kf, sessions_path, G_KEY_FILE_NONE, NULL)) {
+        g_key_file_free(kf);
+        return;
+    }
+
+    CURL *curl = curl_easy_init();
+    if (curl) curl_easy_setopt(curl, CURLOPT_SHARE, share);
+
+    gint64 now = (gint64)time(NULL);
+    int imported = 0;
+    char **groups = g_key_file_get_groups(kf, NULL);
+    for (int i = 0; curl && groups[i]; i++) {
+        gint64 valid_until = g_key_file_get_int64(kf, groups[i],
+                                                  "valid-until", NULL);
+        if (valid_until > 0 && valid_until <= now) continue;
+
+        char *hmac = g_key_file_get_string(kf, groups[i], "shmac", NULL);
+        char *data = g_key_file_get_string(kf, groups[i], "data", NULL);
+        if (hmac && data) {
+            gsize hmac_len = 0, data_len = 0;
+            guchar *shmac = g_base64_decode(hmac, &hmac_len);
+            guchar *sdata = g_base64_decode(data, &data_len);
+            if (hmac_len && data_len &&
+                curl_easy_ssls_import(curl, NULL, shmac, hmac_len,
+                                      sdata, data_len) == CURLE_OK)
+                imported++;
+            g_free(sdata);
+            g_free(shmac);
+        }
+        g_free(data);
+        g_free(hmac);
+    }
+    g_strfreev(groups);
+    if (curl) curl_easy_cleanup(curl);
+    g_key_file_free(kf);
+
+    if (imported)
+        g_message("Resuming %d saved TLS session%s", imported,
+                  imported == 1 ? "" : "s");
+}
+
+static void sessions_save(CURLSH *share) {
+    CURL *curl = curl_easy_init();
+    if (!curl) return;
+    curl_easy_setopt(curl, CURLOPT_SHARE, share);
+
+    SessionExport ex = { g_key_file_new(), 0 };
+    CURLcode res = curl_easy_ssls_export(curl, export_session, &ex);
+    curl_easy_cleanup(curl);
+
+    if (res == CURLE_OK) {
+        gsize len = 0;
+        char *contents = g_key_file_to_data(ex.kf, &len, NULL);
+        GError *error = NULL;
+        if (g_file_set_contents(sessions_path, contents, (gssize)len, &error)) {
+            /* Session tickets let anyone resume as us */
+            g_chmod(sessions_path, 0600);
+        } else {
+            g_warning("Could not save TLS sessions: %s", error->message);
+            g_error_free(error);
+        }
+        g_free(contents);
+    }
+    g_key_file_free(ex.kf);
+}
+
+#else
+
+static void sessions_load(CURLSH *share) { (void)share; }
+static void sessions_save(CURLSH *share) { (void)share; }
+
+#endif
+
+/* ── Alt-svc ───────────────────────────────────────────────────────── */
+
+/* Add the entries of one alt-svc file to merged (origin and alternative →
+ * line), keeping the later expiry where two files know the same one */
+static void altsvc_read(GHashTable *merged, const char *path) {
+    char *contents = NULL;
+    if (!g_file_get_contents(path, &contents, NULL, NULL)) return;
+
+    char **lines = g_strsplit(contents, "\n", -1);
+    for (int i = 0; lines[i]; i++) {
+        const char *line = lines[i];
+        if (!*line || *line == '#') continue;
+        /* alpn host port alpn host port "expiry" persist prio */
+        char **f = g_strsplit(line, " ", 8);
+        if (g_strv_length(f) >= 8) {
+            char *key = g_strjoin(" ", f[0], f[1], f[2], f[3], f[4], f[5],
+                                  NULL);
+            const char *have = g_hash_table_lookup(merged, key);
+            const char *expiry = strchr(line, '"');
+            if (!have || g_strcmp0(expiry, strchr(have, '"')) > 0)
+                g_hash_table_replace(merged, key, g_strdup(line));
+            else
+                g_free(key);
+        }
+        g_strfreev(f);
+    }
+    g_strfreev(lines);
+    g_free(contents);
+}
+
+/* Fold every handle's copy into alt-svc.txt and remove the copies */
+static void altsvc_merge(void) {
+    GDir *dir = g_dir_open(base_dir, 0, NULL);
+    if (!dir) return;
+
+    GPtrArray *copies = g_ptr_array_new_with_free_func(g_free);
+    const char *name;
+    while ((name = g_dir_read_name(dir))) {
+        if (g_str_has_prefix(name, ALTSVC_COPY_PREFIX) &&
+            g_str_has_suffix(name, ".txt"))
+            g_ptr_array_add(copies, g_build_filename(base_dir, name, NULL));
+    }
+    g_dir_close(dir);
+
+    if (copies->len > 0) {
+        GHashTable *merged = g_hash_table_new_full(g_str_hash, g_str_equal,
+                                                   g_free, g_free);
+        altsvc_read(merged, altsvc_path);
+        for (guint i = 0; i < copies->len; i++)
+            altsvc_read(merged, g_ptr_array_index(copies, i));
+
+        GString *out = g_string_new("# Your alt-svc cache. "
+                                    "https://curl.se/docs/alt-svc.html\n");
+        GHashTableIter iter;
+        gpointer line;
+        g_hash_table_iter_init(&iter, merged);
+        while (g_hash_table_iter_next(&iter, NULL, &line))
+            g_string_append_printf(out, "%s\n", (const char *)line);
+        if (g_file_set_contents(altsvc_path, out->str, (gssize)out->len,
+                                NULL)) {
+            for (guint i = 0; i < copies->len; i++)
+                g_remove(g_ptr_array_index(copies, i));
+        }
+        g_string_free(out, TRUE);
+        g_hash_table_destroy(merged);
+    }
+    g_ptr_array_free(copies, TRUE);
+}
+
+/* ── State files ───────────────────────────────────────────────────── */
+
+void net_persist_load(CURLSH *share, const char *dir) {
+    g_free(base_dir);
+    base_dir = dir ? g_strdup(dir)
+                   : g_build_filename(g_get_user_cache_dir(),
+                                      "manga-reader", NULL);
+    g_mkdir_with_parents(base_dir, 0755);
+    g_free(sessions_path);
+    g_free(hsts_path);
+    g_free(altsvc_path);
+    sessions_path = g_build_filename(base_dir, "tls-sessions", NULL);
+    hsts_path = g_build_filename(base_dir, "hsts.txt", NULL);
+    altsvc_path = g_build_filename(base_dir, "alt-svc.txt", NULL);
+
+    /* Copies a crash kept from being merged */
+    altsvc_merge();
+    if (share) sessions_load(share);
+}
+
+void net_persist_attach(CURL *curl) {
+    if (!altsvc_path) return;
+#if LIBCURL_VERSION_NUM >= 0x075800
+    /* Read into, and written from, the share's one HSTS cache; without
+     * a shared cache the handles would overwrite each other's */
+    curl_easy_setopt(curl, CURLOPT_HSTS, hsts_path);
+#endif
+
+    /* A copy of the file per handle, read when the handle is created and
+     * written when it is cleaned up; see altsvc_merge */
+    char *name = g_strdup_printf(ALTSVC_COPY_PREFIX "%d.txt",
+                                 g_atomic_int_add(&altsvc_copies, 1));
+    char *copy = g_build_filename(base_dir, name, NULL);
+    char *contents = NULL;
+    gsize len = 0;
+    if (g_file_get_contents(altsvc_path, &contents, &len, NULL))
+        g_file_set_contents(copy, contents, (gssize)len, NULL);
+    curl_easy_setopt(curl, CURLOPT_ALTSVC, copy);
+    g_free(contents);
+    g_free(copy);
+    g_free(name);
+}
+
+void net_persist_setup(CURL *curl) {
+    if (!altsvc_path) return;
+    curl_easy_setopt(curl, CURLOPT_HSTS_CTRL, (long)CURLHSTS_ENABLE);
+    curl_easy_setopt(curl, CURLOPT_ALTSVC_CTRL,
+                     (long)(CURLALTSVC_H1 | CURLALTSVC_H2));
+}
+
+void net_persist_save(CURLSH *share) {
+    if (share && sessions_path) sessions_save(share);
+    if (altsvc_path) altsvc_merge();
+    g_free(base_dir);
+    g_free(sessions_path);
+    g_free(hsts_path);
+    g_free(altsvc_path);
+    base_dir = NULL;
+    sessions_path = NULL;
+    hsts_path = NULL;
+    altsvc_path = NULL;
+    altsvc_copies = 0;
+}
@@ -0,0 +1,31 @@
+#ifndef NET_PERSIST_H
+#define NET_PERSIST_H
+
+#include <glib.h>
+#include <curl/curl.h>
+
+/* What curl learns about servers that is worth keeping across restarts:
+ * TLS session tickets, HSTS and alt-svc entries. Kept in the cache
+ * directory, so the first requests after a cold start can resume TLS
+ * sessions instead of doing full handshakes. */
+
+/* Read the state saved in dir (NULL: the app's cache directory) into
+ * share. Call once the share is set up. */
+void net_persist_load(CURLSH *share, const char *dir);
+
+/* Point a newly created easy handle at the saved HSTS file and a copy of
+ * the alt-svc file of its own. curl reads them here and writes them back
+ * when the handle is cleaned up; curl_easy_reset keeps what it has
+ * learned. */
+void net_persist_attach(CURL *curl);
+
+/* Options curl_easy_reset clears; call after CURLOPT_SHARE each time a
+ * handle is taken into use. */
+void net_persist_setup(CURL *curl);
+
+/* Write the share's TLS sessions out and merge the handles' alt-svc
+ * copies. Call once every easy handle is cleaned up (curl writes the HSTS
+ * and alt-svc files then) and before the share is. */
+void net_persist_save(CURLSH *share);
+
+#endif /* NET_PERSIST_H */
@@ -0,0 +1,67 @@
+#include "net_quality.h"
+
+#define QUALITY_ALPHA          0.3          /* weight of the newest sample */
+#define QUALITY_MIN_BODY       (16 * 1024)  /* smaller bodies say little about bandwidth */
+#define QUALITY_DEFAULT_PARALLEL 4
+
+static gboolean have_rtt = FALSE;
+static gboolean have_rate = FALSE;
+static gdouble  rtt_s = 0;           /* smoothed time to first byte */
+static gdouble  link_bps = 0;        /* smoothed bytes/s across the link */
+
+static gdouble ewma(gdouble avg, gdouble sample, gboolean *seeded) {
+    if (!*seeded) {
+        *seeded = TRUE;
+        return sample;
+    }
+    return avg + QUALITY_ALPHA * (sample - avg);
+}
+
+void net_quality_record(guint64 body_bytes, gdouble ttfb_s,
+                        gdouble transfer_s, gdouble parallel) {
+    if (ttfb_s > 0)
+        rtt_s = ewma(rtt_s, ttfb_s, &have_rtt);
+
+    /* Each transfer saw its share of the link, so scale back up by the
+     * number running alongside it */
+    if (body_bytes >= QUALITY_MIN_BODY && transfer_s > 0.01) {
+        gdouble bps = body_bytes / transfer_s * MAX(parallel, 1.0);
+        link_bps = ewma(link_bps, bps, &have_rate);
+    }
+}
+
+guint net_quality_concurrency(void) {
+    if (!have_rate) return QUALITY_DEFAULT_PARALLEL;
+
+    /* Weak links do better finishing one page at a time than splitting
+     * the bandwidth until every transfer misses its deadline */
+    if (link_bps < 64 * 1024 || (have_rtt && rtt_s > 1.5)) return 1;
+    if (link_bps < 256 * 1024) return 2;
+    if (link_bps < 1024 * 1024) return 4;
+    return 8;
+}
+
+long net_quality_connect_timeout(void) {
+    if (!have_rtt) return 10;
+    return (long)CLAMP(rtt_s * 6 + 2, 4, 20);
+}
+
+long net_quality_total_timeout(void) {
+    /* A page of HTML is a handful of round trips, even on a slow link */
+    if (!have_rtt) return 30;
+    return (long)CLAMP(rtt_s * 20 + 10, 20, 60);
+}
+
+void net_quality_low_speed(long *bytes_per_s, long *seconds) {
+    /* Only give up on transfers that have all but stalled */
+    gdouble share = have_rate ? link_bps / net_quality_concurrency() : 0;
+    *bytes_per_s = (long)CLAMP(share / 20, 512, 16 * 1024);
+    *seconds = have_rtt ? (long)CLAMP(rtt_s * 10, 10, 30) : 20;
+}
+
+void net_quality_reset(void) {
+    have_rtt = FALSE;
+    have_rate = FALSE;
+    rtt_s = 0;
+    link_bps = 0;
+}
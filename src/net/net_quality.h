@@ -0,0 +1,29 @@
+#ifndef NET_QUALITY_H
+#define NET_QUALITY_H
+
+#include <glib.h>
+
+/* Running estimate of the link, fed by finished transfers and used to
+ * size the engine to it. Network thread only. */
+
+/* Record a successful transfer: body bytes, time to first byte and time
+ * spent receiving the body (seconds), and how many transfers were
+ * sharing the link while it ran, on average over its lifetime. */
+void  net_quality_record(guint64 body_bytes, gdouble ttfb_s,
+                         gdouble transfer_s, gdouble parallel);
+
+/* How many transfers to run at once. */
+guint net_quality_concurrency(void);
+
+/* Connect timeout in seconds. */
+long  net_quality_connect_timeout(void);
+
+/* Overall deadline in seconds for a request the user is waiting on. */
+long  net_quality_total_timeout(void);
+
+/* Abort a transfer that stays below *bytes_per_s for *seconds. */
+void  net_quality_low_speed(long *bytes_per_s, long *seconds);
+
+void  net_quality_reset(void);
+
+#endif /* NET_QUALITY_H */
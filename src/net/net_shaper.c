@@ -0,0 +1,190 @@
+#include "net_shaper.h"
+#include <stdlib.h>
+#include <string.h>
+
+#define SHAPER_MIN_BURST   (16 * 1024)  /* one curl write chunk */
+#define SHAPER_GUESS_BODY  (64 * 1024)  /* where to cut when the length is unknown */
+
+static GMutex   shaper_lock;
+static gint     enabled = FALSE;        /* also read without the lock */
+static gint64   rtt_us = 0;
+static gdouble  bandwidth = 0;          /* bytes/s, 0 = unlimited */
+static gdouble  drop_rate = 0;
+static gdouble  truncate_rate = 0;
+static GRand   *rng = NULL;
+
+/* Link-wide token bucket, in bytes */
+static gdouble  tokens = 0;
+static gint64   refilled_at = 0;
+
+/* ── Configuration ─────────────────────────────────────────────────── */
+
+/* "48k" → 49152; FALSE if value is not a non-negative number */
+static gboolean parse_size(const char *value, gdouble *out) {
+    char *end = NULL;
+    gdouble num = g_ascii_strtod(value, &end);
+    if (end == value || num < 0) return FALSE;
+    if (*end == 'k' || *end == 'K') {
+        num *= 1024;
+        end++;
+    } else if (*end == 'm' || *end == 'M') {
+        num *= 1024 * 1024;
+        end++;
+    }
+    if (*end) return FALSE;
+    *out = num;
+    return TRUE;
+}
+
+/* "400" → 400; FALSE for anything but plain digits up to 32 bits, so a
+ * size suffix on a count or a time ("rtt=1k") is refused, not scaled */
+static gboolean parse_count(const char *value, guint64 *out) {
+    if (!g_ascii_isdigit(value[0])) return FALSE;
+    char *end = NULL;
+    guint64 num = g_ascii_strtoull(value, &end, 10);
+    if (*end || num > G_MAXUINT32) return FALSE;
+    *out = num;
+    return TRUE;
+}
+
+static gboolean parse_chance(const char *value, gdouble *out) {
+    char *end = NULL;
+    gdouble p = g_ascii_strtod(value, &end);
+    if (end == value || *end || p < 0 || p > 1) return FALSE;
+    *out = p;
+    return TRUE;
+}
+
+gboolean net_shaper_configure(const char *spec) {
+    gdouble bw = 0, drop = 0, truncate = 0;
+    guint64 rtt = 0, seed = 1;
+    gboolean ok = TRUE;
+
+    char **fields = g_strsplit(spec ? spec : "", ",", -1);
+    for (int i = 0; ok && fields[i]; i++) {
+        char *field = g_strstrip(fields[i]);
+        if (!*field) continue;
+        char *eq = strchr(field, '=');
+        if (!eq) {
+            ok = FALSE;
+            break;
+        }
+        *eq = '\0';
+        const char *value = eq + 1;
+        if (strcmp(field, "rtt") == 0)
+            ok = parse_count(value, &rtt);
+        else if (strcmp(field, "bw") == 0)
+            ok = parse_size(value, &bw);
+        else if (strcmp(field, "drop") == 0)
+            ok = parse_chance(value, &drop);
+        else if (strcmp(field, "truncate") == 0)
+            ok = parse_chance(value, &truncate);
+        else if (strcmp(field, "seed") == 0)
+            ok = parse_count(value, &seed);
+        else
+            ok = FALSE;
+    }
+    g_strfreev(fields);
+    if (!ok) g_warning("Ignoring network emulation spec \"%s\"", spec);
+
+    g_mutex_lock(&shaper_lock);
+    gboolean on = ok && (rtt > 0 || bw > 0 || drop > 0 || truncate > 0);
+    g_atomic_int_set(&enabled, on);
+    rtt_us = ok ? (gint64)(rtt * 1000) : 0;
+    bandwidth = ok ? bw : 0;
+    drop_rate = ok ? drop : 0;
+    truncate_rate = ok ? truncate : 0;
+    if (rng) g_rand_free(rng);
+    rng = g_rand_new_with_seed((guint32)seed);
+    tokens = MAX(bandwidth / 4, SHAPER_MIN_BURST);
+    refilled_at = g_get_monotonic_time();
+    g_mutex_unlock(&shaper_lock);
+
+    if (on)
+        g_message("Emulating network: rtt %" G_GINT64_FORMAT " ms, "
+                  "%.0f B/s, drop %.2f, truncate %.2f",
+                  rtt_us / 1000, bandwidth, drop_rate, truncate_rate);
+    return ok;
+}
+
+gboolean net_shaper_enabled(void) {
+    return g_atomic_int_get(&enabled);
+}
+
+/* ── Transfers ─────────────────────────────────────────────────────── */
+
+void net_shaper_begin(NetShape *shape) {
+    memset(shape, 0, sizeof(*shape));
+    shape->cut_point = -1;
+    shape->cut_at = -1;
+
+    g_mutex_lock(&shaper_lock);
+    if (enabled) {
+        gdouble roll = g_rand_double(rng);
+        if (roll < drop_rate + truncate_rate) {
+            shape->drop = roll < drop_rate;
+            shape->cut_point = g_rand_double_range(rng, 0.1, 0.9);
+        }
+    }
+    g_mutex_unlock(&shaper_lock);
+}
+
+/* Top up the link bucket for the time since the last refill */
+static void bucket_refill(gint64 now) {
+    gdouble burst = MAX(bandwidth / 4, SHAPER_MIN_BURST);
+    tokens += (now - refilled_at) * bandwidth / G_USEC_PER_SEC;
+    if (tokens > burst) tokens = burst;
+    refilled_at = now;
+}
+
+gboolean net_shaper_admit(NetShape *shape, gint64 now, gboolean new_connection,
+                          gint64 length, size_t len, size_t *take) {
+    *take = len;
+
+    g_mutex_lock(&shaper_lock);
+    if (!enabled) {
+        g_mutex_unlock(&shaper_lock);
+        return TRUE;
+    }
+
+    if (!shape->started) {
+        shape->started = TRUE;
+        shape->hold_until = now + rtt_us * (new_connection ? 3 : 1);
+        if (shape->cut_point >= 0)
+            shape->cut_at = (gint64)((length > 0 ? length : SHAPER_GUESS_BODY)
+                                     * shape->cut_point);
+    }
+
+    gboolean go = now >= shape->hold_until;
+    if (go && bandwidth > 0) {
+        /* Let a whole chunk through on credit; the debt holds back
+         * every transfer until it is paid off */
+        bucket_refill(now);
+        go = tokens > 0;
+    }
+    if (go) {
+        if (shape->cut_at >= 0 &&
+            shape->received + len >= (guint64)shape->cut_at) {
+            *take = (size_t)(shape->cut_at - (gint64)shape->received);
+            shape->cut = TRUE;
+        }
+        if (bandwidth > 0) tokens -= *take;
+        shape->received += *take;
+    }
+    g_mutex_unlock(&shaper_lock);
+    return go;
+}
+
+gint64 net_shaper_resume_at(const NetShape *shape, gint64 now) {
+    if (now < shape->hold_until) return shape->hold_until;
+
+    g_mutex_lock(&shaper_lock);
+    gint64 at = now;
+    if (bandwidth > 0) {
+        bucket_refill(now);
+        if (tokens <= 0)
+            at = now + (gint64)((1 - tokens) / bandwidth * G_USEC_PER_SEC);
+    }
+    g_mutex_unlock(&shaper_lock);
+    return at;
+}
@@ -0,0 +1,50 @@
+#ifndef NET_SHAPER_H
+#define NET_SHAPER_H
+
+#include <glib.h>
+
+/* Emulates a poor link on top of the real one, for testing prefetch,
+ * retry and caching behaviour on a fast development machine. Configured
+ * from a comma-separated spec, e.g. "rtt=400,bw=48k,drop=0.05":
+ *
+ *   rtt=<ms>       added before each response body; new connections
+ *                  pay it three times (TCP, TLS, request)
+ *   bw=<n>[k|m]    bytes/s shared by every transfer
+ *   drop=<p>       chance a transfer's connection dies part-way
+ *   truncate=<p>   chance a body silently ends early
+ *   seed=<n>       random seed, so a run can be repeated
+ *
+ * An empty or NULL spec turns the emulation off. Returns FALSE (and
+ * leaves the emulation off) if the spec does not parse. Thread-safe. */
+gboolean net_shaper_configure(const char *spec);
+
+/* Cheap enough to ask for every chunk: takes no lock. */
+gboolean net_shaper_enabled(void);
+
+/* Per-transfer state, owned by the request. */
+typedef struct {
+    gboolean started;    /* first body byte seen */
+    gint64   hold_until; /* body held back until then (monotonic µs) */
+    guint64  received;   /* body bytes let through */
+    gdouble  cut_point;  /* share of the body before the cut, <0 = none */
+    gint64   cut_at;     /* the same in bytes, once the length is known */
+    gboolean drop;       /* the cut fails the transfer, else it ends short */
+    gboolean cut;        /* the cut has happened */
+    gboolean held;       /* paused by the emulator */
+} NetShape;
+
+/* Roll the dice for a transfer that is about to start. */
+void     net_shaper_begin(NetShape *shape);
+
+/* A chunk of len body bytes arrived. Returns FALSE if the transfer
+ * should pause and offer it again later; otherwise *take is how many
+ * bytes to accept, fewer than len once the cut is reached.
+ * new_connection and length (-1 if unknown) are only used for the
+ * first chunk. */
+gboolean net_shaper_admit(NetShape *shape, gint64 now, gboolean new_connection,
+                          gint64 length, size_t len, size_t *take);
+
+/* When a held transfer may be offered data again. */
+gint64   net_shaper_resume_at(const NetShape *shape, gint64 now);
+
+#endif /* NET_SHAPER_H */
@@ -0,0 +1,43 @@
+#include "net_stats.h"
+#include <string.h>
+
+static GMutex   stats_lock;
+static NetStats stats[NET_CLASS_COUNT];
+
+void net_stats_record(NetClass klass, guint64 wire_bytes,
+                      guint64 decoded_bytes, gdouble seconds) {
+    if (klass >= NET_CLASS_COUNT) return;
+
+    g_mutex_lock(&stats_lock);
+    stats[klass].requests++;
+    stats[klass].wire_bytes += wire_bytes;
+    stats[klass].decoded_bytes += decoded_bytes;
+    stats[klass].seconds += seconds;
+    g_mutex_unlock(&stats_lock);
+}
+
+void net_stats_get(NetClass klass, NetStats *out) {
+    if (klass >= NET_CLASS_COUNT) {
+        memset(out, 0, sizeof(*out));
+        return;
+    }
+
+    g_mutex_lock(&stats_lock);
+    *out = stats[klass];
+    g_mutex_unlock(&stats_lock);
+}
+
+void net_stats_reset(void) {
+    g_mutex_lock(&stats_lock);
+    memset(stats, 0, sizeof(stats));
+    g_mutex_unlock(&stats_lock);
+}
+
+const char *net_stats_class_name(NetClass klass) {
+    switch (klass) {
+    case NET_CLASS_HTML:   return "HTML";
+    case NET_CLASS_IMAGE:  return "Images";
+    case NET_CLASS_UPDATE: return "Updates";
+    default:               return "Other";
+    }
+}
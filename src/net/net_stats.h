@@ -0,0 +1,32 @@
+#ifndef NET_STATS_H
+#define NET_STATS_H
+
+#include <glib.h>
+
+/* What a request was for, so usage can be broken down in settings. */
+typedef enum {
+    NET_CLASS_HTML,     /* source pages */
+    NET_CLASS_IMAGE,    /* chapter pages and covers */
+    NET_CLASS_UPDATE,   /* release check and update download */
+    NET_CLASS_COUNT,
+} NetClass;
+
+typedef struct {
+    guint64 requests;
+    guint64 wire_bytes;      /* headers + body as received */
+    guint64 decoded_bytes;   /* body after content decoding */
+    gdouble seconds;         /* total transfer time */
+} NetStats;
+
+/* Record one finished transfer attempt. Thread-safe. */
+void        net_stats_record(NetClass klass, guint64 wire_bytes,
+                             guint64 decoded_bytes, gdouble seconds);
+
+/* Snapshot the totals for one class since startup (or the last reset). */
+void        net_stats_get(NetClass klass, NetStats *out);
+void        net_stats_reset(void);
+
+/* Human-readable class name for display */
+const char *net_stats_class_name(NetClass klass);
+
+#endif /* NET_STATS_H */
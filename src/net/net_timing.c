@@ -0,0 +1,112 @@
+#include "net_timing.h"
+#include <string.h>
+
+/*
+ * Each slot is guarded by a sequence counter instead of a lock: a writer
+ * makes it odd, fills the slot and makes it even again. A reader copies
+ * the slot and keeps the copy only if the counter was even and unchanged
+ * across the copy. Recording therefore never waits on a dump.
+ */
+typedef struct {
+    gint      seq;
+    NetTiming timing;
+} TimingSlot;
+
+static TimingSlot ring[NET_TIMING_SLOTS];
+static gint       ring_next = 0;   /* total attempts recorded */
+
+void net_timing_record(const NetTiming *timing) {
+    guint n = (guint)g_atomic_int_add(&ring_next, 1);
+    TimingSlot *slot = &ring[n % NET_TIMING_SLOTS];
+
+    g_atomic_int_inc(&slot->seq);
+    /* The odd count must be visible before any of the new contents */
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+    memcpy(&slot->timing, timing, sizeof(*timing));
+    slot->timing.url[NET_TIMING_URL_MAX - 1] = '\0';
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+    g_atomic_int_inc(&slot->seq);
+}
+
+/* Consistent copy of a slot; FALSE if empty or being written */
+static gboolean slot_read(const TimingSlot *slot, NetTiming *out) {
+    gint before = g_atomic_int_get(&slot->seq);
+    if (before == 0 || (before & 1)) return FALSE;
+    memcpy(out, &slot->timing, sizeof(*out));
+    /* Keep the copy from moving past the second look at the counter;
+     * ARM would otherwise let a torn copy pass as consistent */
+    __atomic_thread_fence(__ATOMIC_ACQUIRE);
+    return g_atomic_int_get(&slot->seq) == before;
+}
+
+static void append_json_string(GString *json, const char *s) {
+    g_string_append_c(json, '"');
+    for (; *s; s++) {
+        unsigned char c = (unsigned char)*s;
+        if (c == '"' || c == '\\')
+            g_string_append_printf(json, "\\%c", c);
+        else if (c < 0x20)
+            g_string_append_printf(json, "\\u%04x", c);
+        else
+            g_string_append_c(json, (char)c);
+    }
+    g_string_append_c(json, '"');
+}
+
+static void append_ms(GString *json, const char *name, gint64 us) {
+    g_string_append_printf(json, ", \"%s\": %.3f", name, us / 1000.0);
+}
+
+char *net_timing_to_json(void) {
+    guint end = (guint)g_atomic_int_get(&ring_next);
+    guint start = end > NET_TIMING_SLOTS ? end - NET_TIMING_SLOTS : 0;
+
+    GString *json = g_string_new("[");
+    gboolean first = TRUE;
+    for (guint n = start; n < end; n++) {
+        NetTiming t;
+        if (!slot_read(&ring[n % NET_TIMING_SLOTS], &t)) continue;
+
+        g_string_append(json, first ? "\n  {" : ",\n  {");
+        first = FALSE;
+        g_string_append(json, "\"url\": ");
+        append_json_string(json, t.url);
+        g_string_append_printf(json, ", \"started\": %.3f",
+                               t.started / (gdouble)G_USEC_PER_SEC);
+        g_string_append_printf(json, ", \"status\": %ld, \"result\": %d"
+                               ", \"attempt\": %d, \"priority\": %d",
+                               t.status, t.result, t.attempt, t.priority);
+        g_string_append_printf(json, ", \"size\": %" G_GUINT64_FORMAT, t.size);
+        append_ms(json, "dns_ms", t.namelookup_us);
+        append_ms(json, "connect_ms", t.connect_us);
+        append_ms(json, "tls_ms", t.appconnect_us);
+        append_ms(json, "ttfb_ms", t.starttransfer_us);
+        append_ms(json, "total_ms", t.total_us);
+        g_string_append_c(json, '}');
+    }
+    g_string_append(json, first ? "]\n" : "\n]\n");
+    return g_string_free(json, FALSE);
+}
+
+char *net_timing_save(void) {
+    char *dir = g_build_filename(g_get_user_cache_dir(), "manga-reader", NULL);
+    g_mkdir_with_parents(dir, 0755);
+
+    GDateTime *now = g_date_time_new_now_local();
+    char *name = g_date_time_format(now, "net-timing-%Y%m%d-%H%M%S.json");
+    g_date_time_unref(now);
+    char *path = g_build_filename(dir, name, NULL);
+    g_free(name);
+    g_free(dir);
+
+    char *json = net_timing_to_json();
+    GError *error = NULL;
+    if (!g_file_set_contents(path, json, -1, &error)) {
+        g_warning("Could not save network timings: %s", error->message);
+        g_error_free(error);
+        g_free(path);
+        path = NULL;
+    }
+    g_free(json);
+    return path;
+}
@@ -0,0 +1,39 @@
+#ifndef NET_TIMING_H
+#define NET_TIMING_H
+
+#include <glib.h>
+
+#define NET_TIMING_SLOTS   256   /* most recent transfer attempts kept */
+#define NET_TIMING_URL_MAX 160   /* longer URLs are cut */
+
+/* Where one transfer attempt spent its time. Phases are cumulative from
+ * the start of the attempt, as curl reports them; a reused connection
+ * shows 0 for the phases it skipped. */
+typedef struct {
+    gint64  started;        /* wall clock µs */
+    gint64  namelookup_us;  /* DNS done */
+    gint64  connect_us;     /* TCP connected */
+    gint64  appconnect_us;  /* TLS handshake done */
+    gint64  starttransfer_us; /* first response byte */
+    gint64  total_us;
+    guint64 size;           /* body bytes received */
+    long    status;         /* HTTP status, 0 if none arrived */
+    int     result;         /* CURLcode */
+    int     attempt;        /* 1 for the first try */
+    int     priority;       /* HttpPriority */
+    char    url[NET_TIMING_URL_MAX];
+} NetTiming;
+
+/* Add an attempt to the ring, overwriting the oldest. Lock-free; meant
+ * for the network thread, but safe from anywhere. */
+void     net_timing_record(const NetTiming *timing);
+
+/* Snapshot of the ring, oldest first, as a JSON array. Entries being
+ * overwritten during the copy are skipped. Caller must g_free. */
+char    *net_timing_to_json(void);
+
+/* Write net_timing_to_json() to a new file in the cache directory.
+ * Returns its path, or NULL on failure. Caller must g_free. */
+char    *net_timing_save(void);
+
+#endif /* NET_TIMING_H */
@@ -0,0 +1,101 @@
+#include "rate_limiter.h"
+
+typedef struct {
+    guint    active;        /* transfers holding a slot */
+    gboolean multiplexed;   /* they share HTTP/2 connections */
+    gdouble  tokens;
+    gint64   refilled_at;   /* monotonic µs of the last refill */
+} HostLimit;
+
+static GMutex      limiter_lock;
+static GHashTable *hosts = NULL;   /* host → HostLimit* */
+static guint       max_per_host = RATE_LIMITER_DEFAULT_PER_HOST;
+static gdouble     rate = RATE_LIMITER_DEFAULT_RATE;
+static guint       burst = RATE_LIMITER_DEFAULT_BURST;
+
+void rate_limiter_configure(guint per_host, gdouble per_second, guint max_burst) {
+    g_mutex_lock(&limiter_lock);
+    max_per_host = MAX(per_host, 1);
+    rate = MAX(per_second, 0.0);
+    burst = MAX(max_burst, 1);
+    g_mutex_unlock(&limiter_lock);
+}
+
+static HostLimit *host_limit(const char *host, gint64 now) {
+    if (!hosts)
+        hosts = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, g_free);
+
+    HostLimit *h = g_hash_table_lookup(hosts, host);
+    if (!h) {
+        h = g_new0(HostLimit, 1);
+        h->tokens = burst;
+        h->refilled_at = now;
+        g_hash_table_insert(hosts, g_strdup(host), h);
+    }
+    return h;
+}
+
+/* Top up the bucket for the time since the last refill */
+static void host_refill(HostLimit *h, gint64 now) {
+    if (rate <= 0) return;
+    h->tokens += (now - h->refilled_at) * rate / G_USEC_PER_SEC;
+    if (h->tokens > burst) h->tokens = burst;
+    h->refilled_at = now;
+}
+
+gboolean rate_limiter_ready(const char *host, gint64 now, gint64 *resume_at) {
+    *resume_at = 0;
+    if (!host) return TRUE;
+
+    g_mutex_lock(&limiter_lock);
+    HostLimit *h = host_limit(host, now);
+    gboolean ok = FALSE;
+    guint streams = h->multiplexed ? RATE_LIMITER_STREAMS_PER_CONN : 1;
+    if (h->active < max_per_host * streams) {
+        host_refill(h, now);
+        if (rate <= 0 || h->tokens >= 1.0)
+            ok = TRUE;
+        else
+            *resume_at = now + (gint64)((1.0 - h->tokens) / rate *
+                                        G_USEC_PER_SEC) + 1;
+    }
+    g_mutex_unlock(&limiter_lock);
+    return ok;
+}
+
+void rate_limiter_acquire(const char *host, gint64 now) {
+    if (!host) return;
+
+    g_mutex_lock(&limiter_lock);
+    HostLimit *h = host_limit(host, now);
+    host_refill(h, now);
+    if (rate > 0) h->tokens = MAX(h->tokens - 1.0, 0.0);
+    h->active++;
+    g_mutex_unlock(&limiter_lock);
+}
+
+void rate_limiter_release(const char *host) {
+    if (!host) return;
+
+    g_mutex_lock(&limiter_lock);
+    HostLimit *h = hosts ? g_hash_table_lookup(hosts, host) : NULL;
+    if (h && h->active > 0) h->active--;
+    g_mutex_unlock(&limiter_lock);
+}
+
+void rate_limiter_set_multiplexed(const char *host, gboolean multiplexed) {
+    if (!host) return;
+
+    g_mutex_lock(&limiter_lock);
+    host_limit(host, g_get_monotonic_time())->multiplexed = multiplexed;
+    g_mutex_unlock(&limiter_lock);
+}
+
+void rate_limiter_reset(void) {
+    g_mutex_lock(&limiter_lock);
+    if (hosts) {
+        g_hash_table_destroy(hosts);
+        hosts = NULL;
+    }
+    g_mutex_unlock(&limiter_lock);
+}
@@ -0,0 +1,33 @@
+#ifndef RATE_LIMITER_H
+#define RATE_LIMITER_H
+
+#include <glib.h>
+
+#define RATE_LIMITER_DEFAULT_PER_HOST 4
+#define RATE_LIMITER_DEFAULT_RATE     5.0   /* requests per second per host */
+#define RATE_LIMITER_DEFAULT_BURST    10
+#define RATE_LIMITER_STREAMS_PER_CONN 8     /* HTTP/2 streams a slot stands for */
+
+/* Change the limits applied to every host. A rate of 0 disables the
+ * token bucket. Thread-safe; takes effect for the next request started. */
+void     rate_limiter_configure(guint max_per_host, gdouble rate, guint burst);
+
+/* Whether a transfer to host could start now. On FALSE, *resume_at is
+ * when the next token is due (monotonic µs), or 0 if the host is waiting
+ * for one of its slots to be released. */
+gboolean rate_limiter_ready(const char *host, gint64 now, gint64 *resume_at);
+
+/* Take a connection slot and a token for a transfer that is starting. */
+void     rate_limiter_acquire(const char *host, gint64 now);
+
+/* Give back the slot taken by rate_limiter_acquire. */
+void     rate_limiter_release(const char *host);
+
+/* Whether host was last reached over a multiplexed (HTTP/2) connection.
+ * The per-host limit counts connections, so on such a host each slot
+ * carries several streams. */
+void     rate_limiter_set_multiplexed(const char *host, gboolean multiplexed);
+
+void     rate_limiter_reset(void);
+
+#endif /* RATE_LIMITER_H */
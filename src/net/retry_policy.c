@@ -0,0 +1,162 @@
+#include "retry_policy.h"
+
+#define RETRY_MAX_ATTEMPTS 4
+#define RETRY_BASE_US      500000       /* first backoff: 0.25–0.5 s */
+#define RETRY_MAX_US       8000000      /* backoff cap */
+#define RETRY_AFTER_MAX_S  20           /* longer waits are not worth it */
+
+#define BREAKER_THRESHOLD  5            /* consecutive transient failures */
+#define BREAKER_OPEN_US    (30 * G_USEC_PER_SEC)
+#define BREAKER_HOLD_MAX_S 300          /* cap on a server's Retry-After */
+#define BREAKER_PROBE_US   (35 * G_USEC_PER_SEC)  /* then let another probe go */
+#define BREAKER_DEFER_US   250000
+#define BREAKER_BLOCKING_HOLD_US (3 * G_USEC_PER_SEC)  /* longest a caller waits */
+
+/* ── Classification ────────────────────────────────────────────────── */
+
+RetryOutcome retry_classify(CURLcode res, long status) {
+    switch (res) {
+    case CURLE_OK:
+        break;
+    case CURLE_COULDNT_RESOLVE_HOST:
+    case CURLE_COULDNT_CONNECT:
+    case CURLE_OPERATION_TIMEDOUT:
+    case CURLE_SEND_ERROR:
+    case CURLE_RECV_ERROR:
+    case CURLE_GOT_NOTHING:
+    case CURLE_PARTIAL_FILE:
+    case CURLE_SSL_CONNECT_ERROR:
+    case CURLE_HTTP2:
+    case CURLE_HTTP2_STREAM:
+        return RETRY_OUTCOME_TRANSIENT;
+    default:
+        /* Bad URL, certificate, disk write, cancellation, ... */
+        return RETRY_OUTCOME_FATAL;
+    }
+
+    switch (status) {
+    case 408:   /* Request Timeout */
+    case 425:   /* Too Early */
+    case 429:   /* Too Many Requests */
+    case 500:
+    case 502:
+    case 503:
+    case 504:
+        return RETRY_OUTCOME_TRANSIENT;
+    default:
+        return RETRY_OUTCOME_OK;
+    }
+}
+
+gint64 retry_delay_us(int attempts, gint64 retry_after_s) {
+    if (attempts < 1 || attempts >= RETRY_MAX_ATTEMPTS) return -1;
+    if (retry_after_s > RETRY_AFTER_MAX_S) return -1;
+
+    /* Exponential with jitter in [d/2, d], so requests that failed
+     * together do not all come back at the same moment */
+    gint64 delay = RETRY_BASE_US << (attempts - 1);
+    if (delay > RETRY_MAX_US) delay = RETRY_MAX_US;
+    delay = (gint64)g_random_double_range(delay / 2.0, (gdouble)delay);
+
+    if (retry_after_s * G_USEC_PER_SEC > delay)
+        delay = retry_after_s * G_USEC_PER_SEC;
+    return delay;
+}
+
+/* ── Circuit breaker ───────────────────────────────────────────────── */
+
+typedef struct {
+    int    failures;       /* consecutive transient failures */
+    gint64 open_until;     /* reject everything before this */
+    gint64 hold_until;     /* server asked us to wait (Retry-After) */
+    gint64 probe_until;    /* a half-open probe is in flight */
+} HostBreaker;
+
+static GHashTable *breakers = NULL;   /* host → HostBreaker* */
+
+static HostBreaker *breaker_get(const char *host, gboolean create) {
+    if (!breakers) {
+        if (!create) return NULL;
+        breakers = g_hash_table_new_full(g_str_hash, g_str_equal,
+                                         g_free, g_free);
+    }
+    HostBreaker *b = g_hash_table_lookup(breakers, host);
+    if (!b && create) {
+        b = g_new0(HostBreaker, 1);
+        g_hash_table_insert(breakers, g_strdup(host), b);
+    }
+    return b;
+}
+
+RetryHostState retry_host_check(const char *host, gint64 now,
+                                gboolean blocking, gint64 *resume_at) {
+    HostBreaker *b = host ? breaker_get(host, FALSE) : NULL;
+    if (!b) return RETRY_HOST_ALLOW;
+
+    if (now < b->open_until) return RETRY_HOST_REJECT;
+
+    if (now < b->hold_until) {
+        /* The UI would sit frozen for the whole hold; failing lets the
+         * user try again */
+        if (blocking && b->hold_until - now > BREAKER_BLOCKING_HOLD_US)
+            return RETRY_HOST_REJECT;
+        *resume_at = b->hold_until;
+        return RETRY_HOST_DEFER;
+    }
+
+    if (b->failures >= BREAKER_THRESHOLD) {
+        /* Half-open: let one request through to see if the host is back.
+         * A probe that never reports (cancelled) expires after a while. */
+        if (now < b->probe_until) {
+            *resume_at = now + BREAKER_DEFER_US;
+            return RETRY_HOST_DEFER;
+        }
+        b->probe_until = now + BREAKER_PROBE_US;
+    }
+    return RETRY_HOST_ALLOW;
+}
+
+void retry_host_report(const char *host, RetryOutcome outcome,
+                       gint64 retry_after_s) {
+    if (!host) return;
+
+    if (outcome != RETRY_OUTCOME_TRANSIENT) {
+        HostBreaker *b = breaker_get(host, FALSE);
+        if (!b) return;
+        /* A request already in flight answering does not lift a wait the
+         * server asked for; the breaker closes, the hold runs out */
+        if (b->hold_until > g_get_monotonic_time()) {
+            if (outcome == RETRY_OUTCOME_OK) {
+                b->failures = 0;
+                b->open_until = 0;
+                b->probe_until = 0;
+            }
+            return;
+        }
+        g_hash_table_remove(breakers, host);
+        return;
+    }
+
+    HostBreaker *b = breaker_get(host, TRUE);
+    gint64 now = g_get_monotonic_time();
+    b->failures++;
+    b->probe_until = 0;
+
+    if (retry_after_s > 0) {
+        gint64 hold = MIN(retry_after_s, BREAKER_HOLD_MAX_S);
+        b->hold_until = MAX(b->hold_until, now + hold * G_USEC_PER_SEC);
+    }
+    if (b->failures >= BREAKER_THRESHOLD) {
+        if (b->failures == BREAKER_THRESHOLD)
+            g_warning("Host %s keeps failing; pausing requests for %d s",
+                      host, (int)(BREAKER_OPEN_US / G_USEC_PER_SEC));
+        b->open_until = now + BREAKER_OPEN_US;
+    }
+}
+
+void retry_policy_reset(void) {
+    if (breakers) {
+        g_hash_table_destroy(breakers);
+        breakers = NULL;
+    }
+}
@@ -0,0 +1,38 @@
+#ifndef RETRY_POLICY_H
+#define RETRY_POLICY_H
+
+#include <glib.h>
+#include <curl/curl.h>
+
+/* How a finished transfer attempt went, as far as retrying is concerned. */
+typedef enum {
+    RETRY_OUTCOME_OK,          /* got a usable answer (including 404) */
+    RETRY_OUTCOME_FATAL,       /* failed, but trying again will not help */
+    RETRY_OUTCOME_TRANSIENT,   /* network or server trouble; worth a retry */
+} RetryOutcome;
+
+/* Whether a host may be contacted right now. */
+typedef enum {
+    RETRY_HOST_ALLOW,
+    RETRY_HOST_DEFER,          /* wait until *resume_at, then ask again */
+    RETRY_HOST_REJECT,         /* circuit open: fail without trying */
+} RetryHostState;
+
+/* Classify an attempt from its curl result and, on CURLE_OK, the HTTP
+ * status. */
+RetryOutcome   retry_classify(CURLcode res, long status);
+
+/* Delay in µs before retrying after `attempts` failed tries, honouring
+ * the server's Retry-After (seconds, 0 if absent). -1 means give up. */
+gint64         retry_delay_us(int attempts, gint64 retry_after_s);
+
+/* Per-host circuit breaker. Network thread only; times are monotonic µs.
+ * A blocking request (a caller is waiting on it) is rejected rather than
+ * held back for more than a few seconds. */
+RetryHostState retry_host_check(const char *host, gint64 now,
+                                gboolean blocking, gint64 *resume_at);
+void           retry_host_report(const char *host, RetryOutcome outcome,
+                                 gint64 retry_after_s);
+void           retry_policy_reset(void);
+
+#endif /* RETRY_POLICY_H */
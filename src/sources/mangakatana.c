@@ -15,7 +15,7 @@ static MangaList *mk_search(MangaSource *self, const char *query) {
                                 MK_BASE, encoded);
     g_free(encoded);
 
-    HttpResponse *resp = http_get(url);
+    HttpResponse *resp = http_get_cached(url);
     g_free(url);
     if (!resp || resp->status_code != 200) {
         http_response_free(resp);
@@ -79,7 +79,7 @@ static MangaList *mk_search(MangaSource *self, const char *query) {
 
 static Manga *mk_get_details(MangaSource *self, const char *url) {
     (void)self;
-    HttpResponse *resp = http_get(url);
+    HttpResponse *resp = http_get_cached(url);
     if (!resp || resp->status_code != 200) {
         http_response_free(resp);
         return NULL;
@@ -153,7 +153,7 @@ static PageList *mk_get_pages(MangaSource *self, const char *chapter_url) {
     (void)self;
     PageList *pages = page_list_new();
 
-    HttpResponse *resp = http_get(chapter_url);
+    HttpResponse *resp = http_get_cached(chapter_url);
     if (!resp || resp->status_code != 200) {
         http_response_free(resp);
         return pages;
@@ -211,7 +211,7 @@ static MangaList *mk_get_latest(MangaSource *self) {
     (void)self;
     MangaList *list = manga_list_new();
 
-    HttpResponse *resp = http_get(MK_BASE);
+    HttpResponse *resp = http_get_cached(MK_BASE);
     if (!resp || resp->status_code != 200) {
         http_response_free(resp);
         return list;
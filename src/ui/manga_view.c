@@ -1,7 +1,9 @@
 #include "manga_view.h"
 #include "widgets.h"
 #include "../app.h"
+#include "../net/http.h"
 #include "../net/image_loader.h"
+#include "../net/net_monitor.h"
 #include "../util/database.h"
 #include <string.h>
 
@@ -53,6 +55,13 @@ static void on_resume_cancel(GtkWidget *button, gpointer user_data) {
     g_free(data);
 }
 
+/* Open connections to the image CDN the last chapter was served from */
+static void warm_up_page_host(void) {
+    char *page_url = db_get_setting("last_page_url");
+    http_warm_up(page_url);
+    g_free(page_url);
+}
+
 static void on_chapter_clicked(GtkWidget *button, gpointer user_data) {
     const char *manga_url = user_data;
     const char *chapter_url = g_object_get_data(G_OBJECT(button), "chapter-url");
@@ -178,7 +187,9 @@ static gboolean manga_view_populate(gpointer user_data) {
     }
 
     if (!td->manga) {
-        GtkWidget *err = widgets_status_label_new("Failed to load manga.");
+        GtkWidget *err = widgets_status_label_new(
+            net_monitor_online() ? "Failed to load manga."
+                                 : "Offline, and this manga is not saved.");
         gtk_box_pack_start(GTK_BOX(vbox), err, FALSE, FALSE, 0);
         gtk_widget_show_all(vbox);
         g_free(td);
@@ -288,6 +299,15 @@ static gboolean manga_view_populate(gpointer user_data) {
     GtkWidget *ch_scroll = widgets_scrolled_new(ch_box);
     gtk_box_pack_start(GTK_BOX(vbox), ch_scroll, TRUE, TRUE, 0);
 
+    /* With the list up, a chapter is the likely next tap. Buttons never
+     * take focus on a touch screen, so the hosts are warmed now: every
+     * chapter lives on the same one, and pages on the CDN. */
+    if (manga->chapters->len > 0) {
+        Chapter *first = g_ptr_array_index(manga->chapters, 0);
+        http_warm_up(first->url);
+    }
+    warm_up_page_host();
+
     gtk_widget_show_all(vbox);
     g_free(td);
     return FALSE;
@@ -336,5 +356,8 @@ GtkWidget *manga_view_new(const char *manga_url) {
     td->vbox = vbox;
     g_thread_create(manga_load_thread_func, td, FALSE, NULL);
 
+    /* Reading a chapter is the likely next step */
+    warm_up_page_host();
+
     return vbox;
 }
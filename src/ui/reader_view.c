@@ -4,6 +4,7 @@
 #include "../device/brightness.h"
 #include "../net/image_loader.h"
 #include "../net/http.h"
+#include "../net/net_monitor.h"
 #include "../util/cache.h"
 #include "../util/database.h"
 #include <string.h>
@@ -12,6 +13,9 @@
 
 typedef enum { FIT_SCREEN, FIT_WIDTH, FIT_HEIGHT } FitMode;
 
+typedef struct PageDownload PageDownload;
+typedef struct PageSlot PageSlot;
+
 typedef struct {
     char      *chapter_url;
     PageList  *pages;
@@ -25,7 +29,8 @@ typedef struct {
 
     /* Widgets */
     GtkWidget *vbox;
-    GtkWidget *image_widget;
+    GtkWidget *image_widget;      /* drawing area painting shown */
+    GrayImage *shown;
     GtkWidget *event_box;
     GtkWidget *scrolled_window;
     GtkWidget *top_bar;
@@ -36,11 +41,15 @@ typedef struct {
     GtkWidget *loading_overlay;
     guint      spinner_tick_id;
     guint      page_wait_tick_id;
+    gboolean   waiting_offline;   /* page label says the page is on hold */
+    PageSlot  *ring;              /* decoded pages around current_page */
 
     /* Bulk prefetch */
-    GThread   *prefetch_thread;
-    gboolean   prefetch_cancel;
-    gint       prefetch_done;     /* pages cached so far (atomic) */
+    GThread   *prefetch_thread;   /* fetches the page list */
+    GCancellable *cancel;         /* aborts page downloads on destroy */
+    PageDownload *downloads;      /* one per page, see prefetch_start_downloads */
+    int        priority_page;     /* page the download priorities follow */
+    int        prefetch_done;     /* pages cached so far */
     int        prefetch_total;
     gboolean   reading_started;   /* first page shown, user can read */
 
@@ -52,6 +61,7 @@ typedef struct {
 
 static void reader_show_page(ReaderViewData *data);
 static void toggle_toolbar(ReaderViewData *data);
+static void prefetch_follow_reader(ReaderViewData *data);
 
 /* ── Loading overlay ───────────────────────────────────────────────── */
 
@@ -61,7 +71,7 @@ static gboolean update_download_progress(gpointer user_data) {
 
     if (data->prefetch_total > 0) {
         char *text = g_strdup_printf("Downloading %d / %d...",
-                                      g_atomic_int_get(&data->prefetch_done),
+                                      data->prefetch_done,
                                       data->prefetch_total);
         widgets_spinner_set_text(data->loading_overlay, text);
         g_free(text);
@@ -409,12 +419,208 @@ static gboolean wait_for_page_tick(gpointer user_data) {
         reader_show_page(data);
         return FALSE;  /* stop polling */
     }
+
+    /* The download carries on by itself once the network is back */
+    gboolean offline = !net_monitor_online();
+    if (offline != data->waiting_offline) {
+        data->waiting_offline = offline;
+        char *text = g_strdup_printf(offline ? "Page %d / %d (offline)"
+                                             : "Page %d / %d",
+                                     data->current_page + 1,
+                                     (int)data->pages->image_urls->len);
+        gtk_label_set_text(GTK_LABEL(data->page_label), text);
+        g_free(text);
+    }
     return TRUE;  /* keep polling */
 }
 
+/* ── Page ring ─────────────────────────────────────────────────────── */
+
+/* Pages from one behind to two ahead of the current one are kept decoded,
+ * scaled, grayscaled and rotated, so a turn only swaps the image. A
+ * full-screen 8-bit page on a Paperwhite is ~1.5 MB; past the budget the
+ * pages furthest from the reader go first. */
+#define PAGE_RING_BEHIND 1
+#define PAGE_RING_AHEAD  2
+#define PAGE_RING_SLOTS  (PAGE_RING_BEHIND + 1 + PAGE_RING_AHEAD)
+#define PAGE_RING_BUDGET (12 * 1024 * 1024)
+
+/* A decoded page, or one being decoded while pending is set */
+struct PageSlot {
+    ReaderViewData *reader;
+    int             index;      /* -1 when free */
+    FitMode         fit_mode;   /* what the page was rendered for */
+    int             rotation;
+    GrayImage      *image;
+    GCancellable   *pending;
+};
+
+static void slot_clear(PageSlot *slot) {
+    if (slot->pending) {
+        g_cancellable_cancel(slot->pending);
+        g_object_unref(slot->pending);
+        slot->pending = NULL;
+    }
+    if (slot->image) {
+        gray_image_unref(slot->image);
+        slot->image = NULL;
+    }
+    slot->index = -1;
+}
+
+/* Rotation resets on every turn, so only the current page can be rotated */
+static gboolean slot_wanted(ReaderViewData *data, PageSlot *slot) {
+    int distance = slot->index - data->current_page;
+    if (distance < -PAGE_RING_BEHIND || distance > PAGE_RING_AHEAD)
+        return FALSE;
+    int rotation = distance == 0 ? data->rotation : 0;
+    return slot->fit_mode == data->fit_mode && slot->rotation == rotation;
+}
+
+static PageSlot *ring_find(ReaderViewData *data, int index) {
+    for (int i = 0; i < PAGE_RING_SLOTS; i++)
+        if (data->ring[i].index == index) return &data->ring[i];
+    return NULL;
+}
+
+static size_t ring_bytes(ReaderViewData *data) {
+    size_t bytes = 0;
+    for (int i = 0; i < PAGE_RING_SLOTS; i++)
+        if (data->ring[i].image)
+            bytes += gray_image_size(data->ring[i].image);
+    return bytes;
+}
+
+/* Drop pages furthest from the reader until the ring fits its budget;
+ * the current page always stays */
+static void ring_trim(ReaderViewData *data) {
+    while (ring_bytes(data) > PAGE_RING_BUDGET) {
+        PageSlot *victim = NULL;
+        int victim_distance = 0;
+        for (int i = 0; i < PAGE_RING_SLOTS; i++) {
+            PageSlot *slot = &data->ring[i];
+            int distance = ABS(slot->index - data->current_page);
+            if (slot->image && distance > victim_distance) {
+                victim = slot;
+                victim_distance = distance;
+            }
+        }
+        if (!victim) break;
+        slot_clear(victim);
+    }
+}
+
+/* Paint the shown page centred, as a GtkImage would */
+static gboolean on_page_expose(GtkWidget *widget, GdkEventExpose *event,
+                               gpointer user_data) {
+    ReaderViewData *data = user_data;
+    GrayImage *image = data->shown;
+    if (!image) return FALSE;
+
+    GdkRectangle area = {
+        MAX(0, (widget->allocation.width - image->width) / 2),
+        MAX(0, (widget->allocation.height - image->height) / 2),
+        image->width, image->height
+    };
+    GdkRectangle part;
+    if (!gdk_rectangle_intersect(&event->area, &area, &part)) return TRUE;
+
+    gdk_draw_gray_image(widget->window,
+                        widget->style->fg_gc[GTK_WIDGET_STATE(widget)],
+                        part.x, part.y, part.width, part.height,
+                        GDK_RGB_DITHER_NONE,
+                        image->pixels + (part.y - area.y) * image->rowstride
+                                      + (part.x - area.x),
+                        image->rowstride);
+    return TRUE;
+}
+
+/* Show image, or nothing if it is NULL */
+static void ring_show(ReaderViewData *data, GrayImage *image) {
+    if (image) gray_image_ref(image);
+    gray_image_unref(data->shown);
+    data->shown = image;
+    gtk_widget_set_size_request(data->image_widget,
+                                image ? image->width : -1,
+                                image ? image->height : -1);
+    gtk_widget_queue_draw(data->image_widget);
+
+    /* Scroll to top (for FIT_WIDTH) */
+    GtkAdjustment *vadj = gtk_scrolled_window_get_vadjustment(
+        GTK_SCROLLED_WINDOW(data->scrolled_window));
+    gtk_adjustment_set_value(vadj, 0);
+}
+
+static void on_slot_rendered(GrayImage *image, gpointer user_data) {
+    PageSlot *slot = user_data;
+    ReaderViewData *data = slot->reader;
+    g_object_unref(slot->pending);
+    slot->pending = NULL;
+
+    if (slot->index == data->current_page) ring_show(data, image);
+    if (!image) {
+        slot->index = -1;
+        return;
+    }
+    slot->image = image;
+    ring_trim(data);
+}
+
+/* Decode, scale and grayscale a page on the image loader's worker */
+static void ring_render(ReaderViewData *data, int index) {
+    PageSlot *slot = ring_find(data, -1);
+    if (!slot) return;
+
+    int max_w = data->display_width;
+    int max_h = data->display_height;
+    switch (data->fit_mode) {
+    case FIT_SCREEN: break;
+    case FIT_WIDTH:  max_h = 0; break;
+    case FIT_HEIGHT: max_w = 0; break;
+    }
+
+    slot->reader = data;
+    slot->index = index;
+    slot->fit_mode = data->fit_mode;
+    slot->rotation = index == data->current_page ? data->rotation : 0;
+    slot->pending = g_cancellable_new();
+    image_loader_render_async(g_ptr_array_index(data->pages->image_urls, index),
+                              max_w, max_h,
+                              slot->rotation ? GDK_PIXBUF_ROTATE_CLOCKWISE
+                                             : GDK_PIXBUF_ROTATE_NONE,
+                              on_slot_rendered, slot, slot->pending);
+}
+
+/* Bring the ring in line with the current page: drop what is out of
+ * range or was rendered for another fit mode or rotation, then queue the
+ * current page, the ones ahead and the one behind, in that order. Pages
+ * not on disk yet are picked up when their download lands. */
+static void ring_fill(ReaderViewData *data) {
+    for (int i = 0; i < PAGE_RING_SLOTS; i++)
+        if (data->ring[i].index >= 0 && !slot_wanted(data, &data->ring[i]))
+            slot_clear(&data->ring[i]);
+
+    static const int order[PAGE_RING_SLOTS] = { 0, 1, 2, -1 };
+    int total = (int)data->pages->image_urls->len;
+    for (int i = 0; i < PAGE_RING_SLOTS; i++) {
+        int index = data->current_page + order[i];
+        if (index < 0 || index >= total || ring_find(data, index)) continue;
+        /* Speculative pages only while there is room for them */
+        if (order[i] != 0 && ring_bytes(data) >= PAGE_RING_BUDGET) break;
+
+        char *key = cache_key_from_url(g_ptr_array_index(data->pages->image_urls,
+                                                         index));
+        gboolean cached = cache_has(key);
+        g_free(key);
+        if (cached) ring_render(data, index);
+    }
+}
+
 static void reader_show_page(ReaderViewData *data) {
     if (!data->pages || data->pages->image_urls->len == 0) return;
 
+    prefetch_follow_reader(data);
+
     const char *url = g_ptr_array_index(data->pages->image_urls,
                                          data->current_page);
 
@@ -425,7 +631,8 @@ static void reader_show_page(ReaderViewData *data) {
 
     if (!cached) {
         /* Show spinner and poll until the prefetch thread caches it */
-        gtk_image_clear(GTK_IMAGE(data->image_widget));
+        ring_fill(data);
+        ring_show(data, NULL);
         show_loading(data);
         /* Update label/slider even while waiting */
         char *text = g_strdup_printf("Page %d / %d",
@@ -433,6 +640,7 @@ static void reader_show_page(ReaderViewData *data) {
                                       (int)data->pages->image_urls->len);
         gtk_label_set_text(GTK_LABEL(data->page_label), text);
         g_free(text);
+        data->waiting_offline = FALSE;
         update_slider(data);
         /* Cancel any existing poll before starting a new one */
         if (data->page_wait_tick_id)
@@ -443,27 +651,11 @@ static void reader_show_page(ReaderViewData *data) {
 
     hide_loading(data);
 
-    int max_w = data->display_width;
-    int max_h = data->display_height;
-    switch (data->fit_mode) {
-    case FIT_SCREEN: break;
-    case FIT_WIDTH:  max_h = 0; break;
-    case FIT_HEIGHT: max_w = 0; break;
-    }
-
-    GdkPixbuf *pb = image_loader_fetch_processed(url, max_w, max_h, TRUE);
-    if (pb) {
-        if (data->rotation) {
-            GdkPixbuf *rotated = gdk_pixbuf_rotate_simple(pb,
-                                     GDK_PIXBUF_ROTATE_CLOCKWISE);
-            g_object_unref(pb);
-            pb = rotated;
-        }
-        gtk_image_set_from_pixbuf(GTK_IMAGE(data->image_widget), pb);
-        g_object_unref(pb);
-    } else {
-        gtk_image_clear(GTK_IMAGE(data->image_widget));
-    }
+    /* A ready page goes straight up; otherwise the previous one stays
+     * until the decode lands */
+    ring_fill(data);
+    PageSlot *slot = ring_find(data, data->current_page);
+    if (slot && slot->image) ring_show(data, slot->image);
 
     /* Update label + slider */
     char *text = g_strdup_printf("Page %d / %d",
@@ -482,15 +674,118 @@ static void reader_show_page(ReaderViewData *data) {
             db_mark_chapter_completed(app->current_manga->url, data->chapter_url);
         }
     }
-
-    /* Scroll to top (for FIT_WIDTH) */
-    GtkAdjustment *vadj = gtk_scrolled_window_get_vadjustment(
-        GTK_SCROLLED_WINDOW(data->scrolled_window));
-    gtk_adjustment_set_value(vadj, 0);
 }
 
 /* ── Bulk prefetch: download all pages to disk cache ───────────────── */
 
+/* Per-page context for http_fetch_async; owned by ReaderViewData so it
+ * stays valid until the view is destroyed (cancelled fetches never call back) */
+struct PageDownload {
+    ReaderViewData *reader;
+    guint           index;
+};
+
+static void on_page_downloaded(HttpResponse *resp, gpointer user_data) {
+    PageDownload *dl = user_data;
+    ReaderViewData *data = dl->reader;
+
+    /* The body was streamed into the cache on the network thread */
+    http_response_free(resp);
+    data->prefetch_done++;
+
+    /* Show the page straight away if the reader is waiting on it */
+    if ((int)dl->index == data->current_page && data->page_wait_tick_id) {
+        g_source_remove(data->page_wait_tick_id);
+        data->page_wait_tick_id = 0;
+        reader_show_page(data);
+        return;
+    }
+
+    /* Decode it ahead of time if it is one of the neighbours */
+    int distance = (int)dl->index - data->current_page;
+    if (data->reading_started &&
+        distance >= -PAGE_RING_BEHIND && distance <= PAGE_RING_AHEAD)
+        ring_fill(data);
+}
+
+/* A download queued again by prefetch_follow_reader after the first one
+ * failed; on_page_downloaded has already counted the page */
+static void on_page_refetched(HttpResponse *resp, gpointer user_data) {
+    PageDownload *dl = user_data;
+    ReaderViewData *data = dl->reader;
+    http_response_free(resp);
+
+    if ((int)dl->index == data->current_page && data->page_wait_tick_id) {
+        g_source_remove(data->page_wait_tick_id);
+        data->page_wait_tick_id = 0;
+        reader_show_page(data);
+    }
+}
+
+/* Downloads follow the reader: the page on screen becomes user-blocking
+ * and its neighbours next-visible, and the ones around the page before
+ * go back to speculative, so a jump does not wait behind the pages
+ * queued ahead of it */
+static void prefetch_follow_reader(ReaderViewData *data) {
+    int old = data->priority_page;
+    int current = data->current_page;
+    int n = (int)data->pages->image_urls->len;
+    if (!data->downloads || old == current) return;
+
+    for (int i = old - 1; i <= old + 1; i++) {
+        if (i < 0 || i >= n || ABS(i - current) <= 1) continue;
+        http_set_priority(g_ptr_array_index(data->pages->image_urls, i),
+                          HTTP_PRIORITY_SPECULATIVE);
+    }
+
+    for (int i = current - 1; i <= current + 1; i++) {
+        if (i < 0 || i >= n) continue;
+        const char *url = g_ptr_array_index(data->pages->image_urls, i);
+        char *key = cache_key_from_url(url);
+        HttpPriority priority = i == current ? HTTP_PRIORITY_USER_BLOCKING
+                                             : HTTP_PRIORITY_NEXT_VISIBLE;
+        /* Nothing in flight: the first download failed, so try again */
+        if (!cache_has(key) && !http_set_priority(url, priority)) {
+            data->downloads[i].reader = data;
+            data->downloads[i].index = (guint)i;
+            http_fetch_to_cache_async(url, key, priority,
+                                      on_page_refetched, &data->downloads[i],
+                                      data->cancel);
+        }
+        g_free(key);
+    }
+    data->priority_page = current;
+}
+
+/* Queue every uncached page on the network thread: the page being shown
+ * first, then its neighbours, then the rest of the chapter */
+static void prefetch_start_downloads(ReaderViewData *data) {
+    guint n = data->pages->image_urls->len;
+    data->downloads = g_new0(PageDownload, n);
+    data->priority_page = data->current_page;
+
+    for (guint i = 0; i < n; i++) {
+        const char *url = g_ptr_array_index(data->pages->image_urls, i);
+        char *key = cache_key_from_url(url);
+        if (cache_has(key)) {
+            g_free(key);
+            data->prefetch_done++;
+            continue;
+        }
+
+        data->downloads[i].reader = data;
+        data->downloads[i].index = i;
+        int distance = ABS((int)i - data->current_page);
+        HttpPriority priority = distance == 0 ? HTTP_PRIORITY_USER_BLOCKING
+                              : distance == 1 ? HTTP_PRIORITY_NEXT_VISIBLE
+                              : HTTP_PRIORITY_SPECULATIVE;
+        http_fetch_to_cache_async(url, key, priority,
+                                  on_page_downloaded, &data->downloads[i],
+                                  data->cancel);
+        g_free(key);
+    }
+}
+
 /* Called on main thread once we have the page list — lets the user start reading */
 static gboolean prefetch_pages_ready(gpointer user_data) {
     ReaderViewData *data = user_data;
@@ -498,10 +793,20 @@ static gboolean prefetch_pages_ready(gpointer user_data) {
 
     if (!data->pages || data->pages->image_urls->len == 0) {
         hide_loading(data);
-        gtk_label_set_text(GTK_LABEL(data->page_label), "No pages found.");
+        gtk_label_set_text(GTK_LABEL(data->page_label),
+                           net_monitor_online()
+                               ? "No pages found."
+                               : "Offline, and this chapter is not saved.");
         return FALSE;
     }
 
+    data->prefetch_total = (int)data->pages->image_urls->len;
+
+    /* Pages usually come from the same CDN chapter after chapter, so the
+     * next chapter can start connecting to it before its list arrives */
+    db_set_setting("last_page_url",
+                   g_ptr_array_index(data->pages->image_urls, 0));
+
     /* Store total pages count in app for progress tracking */
     App *app = app_get();
     app->current_chapter_total_pages = (int)data->pages->image_urls->len;
@@ -512,107 +817,67 @@ static gboolean prefetch_pages_ready(gpointer user_data) {
     if (data->current_page >= (int)data->pages->image_urls->len)
         data->current_page = 0;
 
+    prefetch_start_downloads(data);
+
     data->reading_started = TRUE;
     update_slider(data);
     reader_show_page(data);  /* will show spinner if page not cached yet */
     return FALSE;
 }
 
-#define PREFETCH_CONCURRENT 4
-
-typedef struct {
-    ReaderViewData *reader;
-    const char     *url;
-} PageDownloadTask;
-
-static void page_download_worker(gpointer task_data, gpointer user_data) {
-    PageDownloadTask *task = task_data;
-    ReaderViewData *data = user_data;
-
-    if (data->prefetch_cancel || data->destroyed) {
-        g_free(task);
-        return;
-    }
-
-    char *key = cache_key_from_url(task->url);
-
-    if (!cache_has(key)) {
-        HttpResponse *resp = http_get(task->url);
-        /* Only cache if we haven't been cancelled while downloading */
-        if (!data->prefetch_cancel && !data->destroyed &&
-            resp && resp->status_code == 200 && resp->data) {
-            cache_put(key, resp->data, resp->size);
-        }
-        http_response_free(resp);
-    }
-
-    g_free(key);
-    g_atomic_int_inc(&data->prefetch_done);
-    g_free(task);
-}
-
+/* Background thread: the source API is blocking, so the page list is
+ * fetched here; the page images themselves go through http_fetch_async */
 static gpointer prefetch_thread_func(gpointer user_data) {
     ReaderViewData *data = user_data;
 
-    /* Step 1: fetch page list */
     App *app = app_get();
     PageList *pages = app->source->get_chapter_pages(app->source,
                                                       data->chapter_url);
-    if (data->prefetch_cancel || data->destroyed) {
+    if (g_cancellable_is_cancelled(data->cancel) || data->destroyed) {
         page_list_free(pages);
         return NULL;
     }
 
     data->pages = pages;
-    if (!pages || pages->image_urls->len == 0) {
-        g_idle_add(prefetch_pages_ready, data);
-        return NULL;
-    }
-
-    data->prefetch_total = (int)pages->image_urls->len;
-
-    /* Step 2: let the user start reading immediately */
     g_idle_add(prefetch_pages_ready, data);
-
-    /* Step 3: download pages concurrently via thread pool */
-    GThreadPool *pool = g_thread_pool_new(page_download_worker, data,
-                                           PREFETCH_CONCURRENT, FALSE, NULL);
-
-    for (guint i = 0; i < pages->image_urls->len; i++) {
-        if (data->prefetch_cancel || data->destroyed) break;
-
-        PageDownloadTask *task = g_new(PageDownloadTask, 1);
-        task->reader = data;
-        task->url = g_ptr_array_index(pages->image_urls, i);
-        g_thread_pool_push(pool, task, NULL);
-    }
-
-    /* Wait for in-flight workers; discard queued ones if cancelled */
-    g_thread_pool_free(pool, data->prefetch_cancel, TRUE);
-
     return NULL;
 }
 
 /* ── Cleanup ───────────────────────────────────────────────────────── */
 
+static void reader_data_free(ReaderViewData *data) {
+    g_free(data->chapter_url);
+    page_list_free(data->pages);
+    g_free(data->downloads);
+    for (int i = 0; i < PAGE_RING_SLOTS; i++)
+        slot_clear(&data->ring[i]);
+    g_free(data->ring);
+    gray_image_unref(data->shown);
+    g_object_unref(data->cancel);
+    g_free(data);
+}
+
 /* Background thread that joins the prefetch thread and frees the data,
- * so the main thread never blocks waiting for in-flight downloads. */
+ * so the main thread never blocks waiting for the page list request. */
 static gpointer cleanup_thread_func(gpointer user_data) {
     ReaderViewData *data = user_data;
     if (data->prefetch_thread) {
         g_thread_join(data->prefetch_thread);
         data->prefetch_thread = NULL;
     }
-    g_free(data->chapter_url);
-    page_list_free(data->pages);
-    g_free(data);
+    reader_data_free(data);
     return NULL;
 }
 
 static void on_data_destroy(gpointer user_data) {
     ReaderViewData *data = user_data;
     data->destroyed = TRUE;
-    data->prefetch_cancel = TRUE;
+
+    /* Abort in-flight page downloads and drop any queued completions */
+    g_cancellable_cancel(data->cancel);
+    for (int i = 0; i < PAGE_RING_SLOTS; i++)
+        if (data->ring[i].pending)
+            g_cancellable_cancel(data->ring[i].pending);
 
     /* Remove all pending timers */
     if (data->spinner_tick_id) {
@@ -628,13 +893,11 @@ static void on_data_destroy(gpointer user_data) {
     while (g_idle_remove_by_data(data)) { /* drain all */ }
 
     /* Join the prefetch thread and free data in the background
-     * so we don't block the UI waiting for in-flight downloads. */
+     * so we don't block the UI waiting for the page list request. */
     if (data->prefetch_thread) {
         g_thread_create(cleanup_thread_func, data, FALSE, NULL);
     } else {
-        g_free(data->chapter_url);
-        page_list_free(data->pages);
-        g_free(data);
+        reader_data_free(data);
     }
 }
 
@@ -655,6 +918,15 @@ GtkWidget *reader_view_new(const char *chapter_url) {
     data->toolbar_visible = TRUE;
     data->slider_updating = FALSE;
     data->destroyed = FALSE;
+    data->cancel = g_cancellable_new();
+    data->ring = g_new0(PageSlot, PAGE_RING_SLOTS);
+    for (int i = 0; i < PAGE_RING_SLOTS; i++)
+        data->ring[i].index = -1;
+
+    http_warm_up(chapter_url);
+    char *page_url = db_get_setting("last_page_url");
+    http_warm_up(page_url);
+    g_free(page_url);
 
     App *app = app_get();
     data->chapter_index = app->current_chapter_index;
@@ -725,7 +997,9 @@ GtkWidget *reader_view_new(const char *chapter_url) {
     gtk_box_pack_start(GTK_BOX(content_vbox), data->loading_overlay,
                        FALSE, FALSE, 0);
 
-    data->image_widget = gtk_image_new();
+    data->image_widget = gtk_drawing_area_new();
+    g_signal_connect(data->image_widget, "expose-event",
+                     G_CALLBACK(on_page_expose), data);
     gtk_box_pack_start(GTK_BOX(content_vbox), data->image_widget,
                        TRUE, TRUE, 0);
 
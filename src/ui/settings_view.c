@@ -2,8 +2,10 @@
 #include "widgets.h"
 #include "../app.h"
 #include "../updater.h"
+#include "../net/http.h"
+#include "../net/net_stats.h"
+#include "../net/net_timing.h"
 #include "../util/database.h"
-#include "../util/cache.h"
 #include <glib/gstdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -91,21 +93,8 @@ static void on_clear_confirm_yes(GtkWidget *button, gpointer user_data) {
     (void)button;
     (void)user_data;
     
-    cache_shutdown();
-    
-    char *cache_dir = g_build_filename(g_get_user_cache_dir(),
-                                       "manga-reader", "images", NULL);
-    
-    /* Simple recursive delete using system command */
-    char *cmd = g_strdup_printf("rm -rf '%s'", cache_dir);
-    system(cmd);
-    g_free(cmd);
-    g_free(cache_dir);
-    
-    char *new_cache = g_build_filename(g_get_user_cache_dir(),
-                                       "manga-reader", NULL);
-    cache_init(new_cache);
-    g_free(new_cache);
+    /* Transfers writing into the cache are stopped before it is emptied */
+    http_clear_cache();
     
     /* Return to settings view */
     app_show_settings(app_get());
@@ -192,6 +181,47 @@ static void on_check_update_clicked(GtkWidget *button, gpointer user_data) {
     updater_check(app_get(), TRUE);
 }
 
+/* One line per request class: wire bytes vs decoded bytes and time spent */
+static char *format_network_usage(void) {
+    GString *text = g_string_new(NULL);
+
+    for (int i = 0; i < NET_CLASS_COUNT; i++) {
+        NetStats st;
+        net_stats_get((NetClass)i, &st);
+
+        char *wire = g_format_size(st.wire_bytes);
+        char *decoded = g_format_size(st.decoded_bytes);
+        g_string_append_printf(text, "%s%s: %" G_GUINT64_FORMAT
+                               " requests, %s received (%s decoded), %.1f s",
+                               i ? "\n" : "", net_stats_class_name((NetClass)i),
+                               st.requests, wire, decoded, st.seconds);
+        g_free(wire);
+        g_free(decoded);
+    }
+    return g_string_free(text, FALSE);
+}
+
+static void on_reset_usage_clicked(GtkWidget *button, gpointer user_data) {
+    (void)button;
+    GtkWidget *usage_text = GTK_WIDGET(user_data);
+    net_stats_reset();
+    char *text = format_network_usage();
+    gtk_label_set_text(GTK_LABEL(usage_text), text);
+    g_free(text);
+}
+
+/* Dump per-request timings for diagnosing slow pages */
+static void on_save_timings_clicked(GtkWidget *button, gpointer user_data) {
+    (void)button;
+    GtkWidget *timing_text = GTK_WIDGET(user_data);
+    char *path = net_timing_save();
+    char *text = path ? g_strdup_printf("Saved to %s", path)
+                      : g_strdup("Could not save the timing log.");
+    gtk_label_set_text(GTK_LABEL(timing_text), text);
+    g_free(text);
+    g_free(path);
+}
+
 static void on_back_clicked(GtkWidget *button, gpointer user_data) {
     (void)button;
     (void)user_data;
@@ -287,6 +317,37 @@ GtkWidget *settings_view_new(void) {
     gtk_box_pack_start(GTK_BOX(options), cache_box, FALSE, FALSE, 0);
     gtk_box_pack_start(GTK_BOX(options), widgets_separator_new(), FALSE, FALSE, 8);
 
+    /* Network Usage */
+    GtkWidget *usage_box = gtk_vbox_new(FALSE, 4);
+    GtkWidget *usage_label = widgets_label_new("Network Usage", EINK_FONT_MED_BOLD);
+    gtk_misc_set_alignment(GTK_MISC(usage_label), 0.0, 0.5);
+    gtk_box_pack_start(GTK_BOX(usage_box), usage_label, FALSE, FALSE, 0);
+
+    char *usage = format_network_usage();
+    GtkWidget *usage_text = widgets_label_new(usage, EINK_FONT_SMALL);
+    g_free(usage);
+    gtk_misc_set_alignment(GTK_MISC(usage_text), 0.0, 0.5);
+    gtk_box_pack_start(GTK_BOX(usage_box), usage_text, FALSE, FALSE, 0);
+
+    GtkWidget *usage_btn = widgets_button_new("Reset Counters");
+    g_signal_connect(usage_btn, "clicked", G_CALLBACK(on_reset_usage_clicked), usage_text);
+    gtk_box_pack_start(GTK_BOX(usage_box), usage_btn, FALSE, FALSE, 4);
+
+    GtkWidget *timing_text = widgets_label_new(
+        "Save DNS, connect, TLS and transfer times of recent requests",
+        EINK_FONT_SMALL);
+    gtk_misc_set_alignment(GTK_MISC(timing_text), 0.0, 0.5);
+    gtk_label_set_line_wrap(GTK_LABEL(timing_text), TRUE);
+    gtk_box_pack_start(GTK_BOX(usage_box), timing_text, FALSE, FALSE, 0);
+
+    GtkWidget *timing_btn = widgets_button_new("Save Timing Log");
+    g_signal_connect(timing_btn, "clicked",
+                     G_CALLBACK(on_save_timings_clicked), timing_text);
+    gtk_box_pack_start(GTK_BOX(usage_box), timing_btn, FALSE, FALSE, 4);
+
+    gtk_box_pack_start(GTK_BOX(options), usage_box, FALSE, FALSE, 0);
+    gtk_box_pack_start(GTK_BOX(options), widgets_separator_new(), FALSE, FALSE, 8);
+
     /* Check for Updates */
     GtkWidget *update_box = gtk_vbox_new(FALSE, 4);
     GtkWidget *update_label = widgets_label_new("Check for Updates", EINK_FONT_MED_BOLD);
@@ -469,7 +469,11 @@ static gpointer check_thread_func(gpointer user_data) {
         NULL
     };
 
-    HttpResponse *resp = http_get_with_headers(RELEASES_URL, headers);
+    /* The startup check must not compete with reading */
+    HttpResponse *resp = http_get_with_priority(RELEASES_URL, headers,
+                                                td->force
+                                                    ? HTTP_PRIORITY_USER_BLOCKING
+                                                    : HTTP_PRIORITY_BACKGROUND);
     if (!resp || resp->status_code != 200) {
         g_message("updater: could not fetch releases (status %ld)",
                   resp ? resp->status_code : 0);
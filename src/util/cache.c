@@ -1,13 +1,90 @@
 #include "cache.h"
+#include <glib/gstdio.h>
+#include <errno.h>
 #include <stdio.h>
 #include <string.h>
+#include <unistd.h>
+
+/* Hex digits in a SHA-256 key from cache_key_from_url */
+#define CACHE_KEY_LEN 64
+
+struct CacheWriter {
+    FILE *file;
+    char *tmp_path;
+    char *path;
+};
 
 static char *cache_dir = NULL;
 
+/* Is name a "<key><suffix>" file without the "<key><partner>" it goes
+ * with? A resumable download is a .part file with a .journal next to it
+ * (see http_cache); either one alone is of no use. */
+static gboolean orphan(const char *name, const char *suffix,
+                       const char *partner) {
+    if (!g_str_has_suffix(name, suffix)) return FALSE;
+    char *key = g_strndup(name, strlen(name) - strlen(suffix));
+    char *other = g_strdup_printf("%s" G_DIR_SEPARATOR_S "%s%s",
+                                  cache_dir, key, partner);
+    gboolean alone = !g_file_test(other, G_FILE_TEST_EXISTS);
+    g_free(other);
+    g_free(key);
+    return alone;
+}
+
+/* Remove what interrupted writers left: temp files a crash kept from
+ * being committed or aborted, .part files nothing will resume, and
+ * journals whose .part is gone */
+static void cache_sweep(void) {
+    GDir *dir = g_dir_open(cache_dir, 0, NULL);
+    if (!dir) return;
+
+    GPtrArray *stale = g_ptr_array_new_with_free_func(g_free);
+    const char *name;
+    while ((name = g_dir_read_name(dir))) {
+        if (strstr(name, ".tmp-") || orphan(name, ".part", ".journal") ||
+            orphan(name, ".journal", ".part"))
+            g_ptr_array_add(stale, g_build_filename(cache_dir, name, NULL));
+    }
+    g_dir_close(dir);
+
+    for (guint i = 0; i < stale->len; i++)
+        g_remove(g_ptr_array_index(stale, i));
+    g_ptr_array_free(stale, TRUE);
+}
+
+/* Entries are named by cache_key_from_url, plus a suffix for temp, .part
+ * and .journal files. Anything else in the directory (the database, saved
+ * connection state) is not the cache's to remove. */
+static gboolean cache_file(const char *name) {
+    for (int i = 0; i < CACHE_KEY_LEN; i++) {
+        if (!g_ascii_isxdigit(name[i])) return FALSE;
+    }
+    return name[CACHE_KEY_LEN] == '\0' || name[CACHE_KEY_LEN] == '.';
+}
+
+void cache_clear(void) {
+    if (!cache_dir) return;
+    GDir *dir = g_dir_open(cache_dir, 0, NULL);
+    if (!dir) return;
+
+    GPtrArray *entries = g_ptr_array_new_with_free_func(g_free);
+    const char *name;
+    while ((name = g_dir_read_name(dir))) {
+        if (cache_file(name))
+            g_ptr_array_add(entries, g_build_filename(cache_dir, name, NULL));
+    }
+    g_dir_close(dir);
+
+    for (guint i = 0; i < entries->len; i++)
+        g_remove(g_ptr_array_index(entries, i));
+    g_ptr_array_free(entries, TRUE);
+}
+
 void cache_init(const char *dir) {
     g_free(cache_dir);
     cache_dir = g_strdup(dir);
     g_mkdir_with_parents(cache_dir, 0755);
+    cache_sweep();
 }
 
 void cache_shutdown(void) {
@@ -29,16 +106,109 @@ char *cache_key_from_url(const char *url) {
     return key;
 }
 
-void cache_put(const char *key, const void *data, size_t len) {
+gboolean cache_put(const char *key, const void *data, size_t len) {
+    CacheWriter *w = cache_writer_new(key);
+    if (!w) return FALSE;
+
+    if (cache_writer_write(w, data, len))
+        return cache_writer_commit(w);
+    cache_writer_abort(w);
+    return FALSE;
+}
+
+CacheWriter *cache_writer_new(const char *key) {
     char *path = cache_path(key);
-    if (!path) return;
+    if (!path) return NULL;
 
-    FILE *f = fopen(path, "wb");
-    if (f) {
-        fwrite(data, 1, len, f);
-        fclose(f);
+    char *tmp_path = g_strdup_printf("%s.tmp-XXXXXX", path);
+    int fd = g_mkstemp(tmp_path);
+    FILE *f = fd >= 0 ? fdopen(fd, "wb") : NULL;
+    if (!f) {
+        if (fd >= 0) {
+            close(fd);
+            g_remove(tmp_path);
+        }
+        g_free(tmp_path);
+        g_free(path);
+        return NULL;
     }
-    g_free(path);
+
+    CacheWriter *w = g_new0(CacheWriter, 1);
+    w->file = f;
+    w->tmp_path = tmp_path;
+    w->path = path;
+    return w;
+}
+
+CacheWriter *cache_writer_resume(const char *key, size_t *offset) {
+    char *path = cache_path(key);
+    if (!path) return NULL;
+
+    /* Append mode: whatever a suspended writer left is kept */
+    char *part_path = g_strconcat(path, ".part", NULL);
+    FILE *f = fopen(part_path, "ab");
+    if (!f) {
+        g_free(part_path);
+        g_free(path);
+        return NULL;
+    }
+    fseek(f, 0, SEEK_END);
+    long pos = ftell(f);
+
+    CacheWriter *w = g_new0(CacheWriter, 1);
+    w->file = f;
+    w->tmp_path = part_path;
+    w->path = path;
+    *offset = pos > 0 ? (size_t)pos : 0;
+    return w;
+}
+
+gboolean cache_writer_truncate(CacheWriter *w) {
+    /* Appends always land at the end, so emptying the file rewinds it */
+    return fflush(w->file) == 0 && ftruncate(fileno(w->file), 0) == 0;
+}
+
+gboolean cache_writer_write(CacheWriter *w, const void *data, size_t len) {
+    return fwrite(data, 1, len, w->file) == len;
+}
+
+gboolean cache_writer_write_at(CacheWriter *w, guint64 offset,
+                               const void *data, size_t len) {
+    const char *p = data;
+    while (len > 0) {
+        ssize_t n = pwrite(fileno(w->file), p, len, (off_t)offset);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) return FALSE;
+        p += n;
+        offset += (guint64)n;
+        len -= (size_t)n;
+    }
+    return TRUE;
+}
+
+static void cache_writer_free(CacheWriter *w) {
+    g_free(w->tmp_path);
+    g_free(w->path);
+    g_free(w);
+}
+
+gboolean cache_writer_commit(CacheWriter *w) {
+    gboolean ok = fclose(w->file) == 0 &&
+                  g_rename(w->tmp_path, w->path) == 0;
+    if (!ok) g_remove(w->tmp_path);
+    cache_writer_free(w);
+    return ok;
+}
+
+void cache_writer_abort(CacheWriter *w) {
+    fclose(w->file);
+    g_remove(w->tmp_path);
+    cache_writer_free(w);
+}
+
+void cache_writer_suspend(CacheWriter *w) {
+    fclose(w->file);
+    cache_writer_free(w);
 }
 
 void *cache_get(const char *key, size_t *out_len) {
@@ -55,6 +225,26 @@ void *cache_get(const char *key, size_t *out_len) {
     return contents;
 }
 
+GBytes *cache_get_bytes(const char *key) {
+    char *path = cache_path(key);
+    if (!path) return NULL;
+
+    GMappedFile *mf = g_mapped_file_new(path, FALSE, NULL);
+    g_free(path);
+    if (!mf) return NULL;
+
+    GBytes *bytes = g_mapped_file_get_bytes(mf);
+    g_mapped_file_unref(mf);
+    return bytes;
+}
+
+void cache_remove(const char *key) {
+    char *path = cache_path(key);
+    if (!path) return;
+    g_remove(path);
+    g_free(path);
+}
+
 gboolean cache_has(const char *key) {
     char *path = cache_path(key);
     if (!path) return FALSE;
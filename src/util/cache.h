@@ -3,16 +3,53 @@
 
 #include <glib.h>
 
-/* Initialize the cache in the given directory. */
+/* Initialize the cache in the given directory, removing temp and .part
+ * files that interrupted downloads left behind. Call before any writer
+ * is created. */
 void    cache_init(const char *cache_dir);
 void    cache_shutdown(void);
 
-/* Store raw bytes under a key. */
-void    cache_put(const char *key, const void *data, size_t len);
+/* Delete every entry, including partial downloads. Writers still open
+ * keep writing to files that are gone; stop them first (http_clear_cache
+ * does both). */
+void    cache_clear(void);
+
+/* Store raw bytes under a key. TRUE once the entry is in place. */
+gboolean cache_put(const char *key, const void *data, size_t len);
+
+/* Incremental writer: data goes to a temp file in the cache directory and
+ * only appears under key once committed, so readers never see a partial
+ * entry. Both commit and abort free the writer. */
+typedef struct CacheWriter CacheWriter;
+
+CacheWriter *cache_writer_new(const char *key);
+gboolean     cache_writer_write(CacheWriter *w, const void *data, size_t len);
+gboolean     cache_writer_commit(CacheWriter *w);
+/* Write at an offset instead of appending, so parts of a body can arrive
+ * in any order. Only for writers from cache_writer_new, and not mixed
+ * with cache_writer_write. */
+gboolean     cache_writer_write_at(CacheWriter *w, guint64 offset,
+                                   const void *data, size_t len);
+void         cache_writer_abort(CacheWriter *w);
+
+/* Resumable writer: data goes to "<key>.part", which survives
+ * cache_writer_suspend so a later writer for the same key carries on
+ * where it stopped. *offset is set to the bytes already there. Commit
+ * and abort behave as above. */
+CacheWriter *cache_writer_resume(const char *key, size_t *offset);
+gboolean     cache_writer_truncate(CacheWriter *w);
+void         cache_writer_suspend(CacheWriter *w);
 
 /* Retrieve cached data. Returns NULL if not found. Caller must g_free. */
 void   *cache_get(const char *key, size_t *out_len);
 
+/* Map cached data without copying it. Returns NULL if not found.
+ * Caller must g_bytes_unref. */
+GBytes *cache_get_bytes(const char *key);
+
+/* Delete the entry for a key, if any. */
+void    cache_remove(const char *key);
+
 /* Check if a key exists in cache. */
 gboolean cache_has(const char *key);
 
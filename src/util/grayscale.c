@@ -0,0 +1,416 @@
+#include "grayscale.h"
+#include <math.h>
+#include <string.h>
+
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#define GRAY_NEON 1
+#elif defined(__arm__)
+/* Every Kindle this is built for has NEON; meson.build turns it on for
+ * this file, so a 32-bit ARM build without it is a build mistake */
+#error "grayscale.c must be built with NEON on ARM (-mfpu=neon)"
+#endif
+
+#if defined(__x86_64__) && defined(__GNUC__)
+#include <immintrin.h>
+#define GRAY_X86 1
+#endif
+
+/* BT.601 weights in 8.8 fixed point; they sum to 256, so white stays 255 */
+#define GRAY_R 77
+#define GRAY_G 150
+#define GRAY_B 29
+
+typedef enum {
+    KERNEL_DEFAULT,
+    KERNEL_SSE2,
+    KERNEL_AVX2,
+    KERNEL_NEON,
+} Kernel;
+
+/* ── Scalar ────────────────────────────────────────────────────────── */
+
+/* Channel counts are constants at every call, so each combination
+ * compiles to its own tight loop */
+static inline __attribute__((always_inline))
+void row_scalar(const guint8 *restrict src, int src_channels,
+                guint8 *restrict dst, int dst_channels,
+                int from, int width, const guint8 *restrict lut) {
+    for (int x = from; x < width; x++) {
+        const guint8 *s = src + x * src_channels;
+        guint8 *d = dst + x * dst_channels;
+        guint8 y = (guint8)((GRAY_R * s[0] + GRAY_G * s[1] +
+                             GRAY_B * s[2] + 128) >> 8);
+        if (lut) y = lut[y];
+        d[0] = y;
+        if (dst_channels >= 3) {
+            d[1] = y;
+            d[2] = y;
+        }
+        if (dst_channels == 4)
+            d[3] = src_channels == 4 ? s[3] : 255;
+    }
+}
+
+#define ROW_CASE(sc, dc)                                                   \
+    if (src_channels == (sc) && dst_channels == (dc)) {                    \
+        if (lut) row_scalar(src, sc, dst, dc, from, width, lut);           \
+        else     row_scalar(src, sc, dst, dc, from, width, NULL);          \
+        return;                                                            \
+    }
+
+static void rows_scalar(const guint8 *src, int src_channels,
+                        guint8 *dst, int dst_channels,
+                        int from, int width, const guint8 *lut) {
+    ROW_CASE(3, 1) ROW_CASE(3, 3) ROW_CASE(3, 4)
+    ROW_CASE(4, 1) ROW_CASE(4, 3) ROW_CASE(4, 4)
+}
+
+#undef ROW_CASE
+
+/* ── NEON ──────────────────────────────────────────────────────────── */
+
+#ifdef GRAY_NEON
+
+/* Eight pixels at a time; returns how many were done, the caller finishes
+ * the rest of the row */
+static int rows_neon(const guint8 *src, int src_channels,
+                     guint8 *dst, int dst_channels,
+                     int width, const guint8 *lut) {
+    const uint8x8_t wr = vdup_n_u8(GRAY_R);
+    const uint8x8_t wg = vdup_n_u8(GRAY_G);
+    const uint8x8_t wb = vdup_n_u8(GRAY_B);
+    int x = 0;
+
+    for (; x + 8 <= width; x += 8) {
+        uint8x8_t r, g, b, a;
+        if (src_channels == 4) {
+            uint8x8x4_t p = vld4_u8(src + x * 4);
+            r = p.val[0]; g = p.val[1]; b = p.val[2]; a = p.val[3];
+        } else {
+            uint8x8x3_t p = vld3_u8(src + x * 3);
+            r = p.val[0]; g = p.val[1]; b = p.val[2]; a = vdup_n_u8(255);
+        }
+
+        uint16x8_t sum = vmull_u8(r, wr);
+        sum = vmlal_u8(sum, g, wg);
+        sum = vmlal_u8(sum, b, wb);
+        uint8x8_t y = vrshrn_n_u16(sum, 8);
+
+        if (lut) {
+            guint8 t[8];
+            vst1_u8(t, y);
+            for (int i = 0; i < 8; i++) t[i] = lut[t[i]];
+            y = vld1_u8(t);
+        }
+
+        if (dst_channels == 1) {
+            vst1_u8(dst + x, y);
+        } else if (dst_channels == 3) {
+            uint8x8x3_t o = { { y, y, y } };
+            vst3_u8(dst + x * 3, o);
+        } else {
+            uint8x8x4_t o = { { y, y, y, a } };
+            vst4_u8(dst + x * 4, o);
+        }
+    }
+    return x;
+}
+
+#endif
+
+/* ── SSE2 and AVX2 ─────────────────────────────────────────────────── */
+
+#ifdef GRAY_X86
+
+/* Both take sixteen pixels at a time, widened to four bytes each (RGB
+ * pixels get a zero fourth byte), and sum the weighted channels with
+ * pmaddwd. Only the luminance is vectorised: RGB and RGBA output, and
+ * the LUT, are filled in from it a byte at a time. */
+
+/* Weights for R, G, B, and nothing for alpha, as 16-bit lanes */
+#define GRAY_WEIGHTS ((long long)GRAY_R | (long long)GRAY_G << 16 | \
+                      (long long)GRAY_B << 32)
+
+/* RGB pixels are loaded four bytes each, so the last one reads a byte
+ * past it: keep two pixels spare at the end of 3-channel rows */
+static int block_stop(int src_channels, int width) {
+    return src_channels == 4 ? width : width - 2;
+}
+
+/* Write sixteen gray values y for pixels x.. of the row */
+static inline void block_store(const guint8 *src, int src_channels,
+                               guint8 *dst, int dst_channels,
+                               int x, const guint8 *y, const guint8 *lut) {
+    for (int i = 0; i < 16; i++) {
+        const guint8 *s = src + (x + i) * src_channels;
+        guint8 *d = dst + (x + i) * dst_channels;
+        guint8 v = lut ? lut[y[i]] : y[i];
+        d[0] = v;
+        if (dst_channels >= 3) {
+            d[1] = v;
+            d[2] = v;
+        }
+        if (dst_channels == 4)
+            d[3] = src_channels == 4 ? s[3] : 255;
+    }
+}
+
+static inline guint32 load32(const guint8 *p) {
+    guint32 v;
+    memcpy(&v, p, sizeof(v));
+    return v;
+}
+
+/* Four pixels as 32-bit lanes; RGB ones carry the next pixel's red in
+ * their top byte, which the zero alpha weight drops */
+static inline __m128i sse2_load4(const guint8 *s, int src_channels) {
+    if (src_channels == 4)
+        return _mm_loadu_si128((const __m128i *)s);
+    return _mm_setr_epi32((int)load32(s), (int)load32(s + 3),
+                          (int)load32(s + 6), (int)load32(s + 9));
+}
+
+/* Luminance of four pixels, as 32-bit lanes */
+static inline __m128i sse2_luma4(__m128i px) {
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i w = _mm_set1_epi64x(GRAY_WEIGHTS);
+    /* Per pixel: R*wr + G*wg, then B*wb + 0 */
+    __m128i lo = _mm_madd_epi16(_mm_unpacklo_epi8(px, zero), w);
+    __m128i hi = _mm_madd_epi16(_mm_unpackhi_epi8(px, zero), w);
+    lo = _mm_add_epi32(lo, _mm_srli_epi64(lo, 32));
+    hi = _mm_add_epi32(hi, _mm_srli_epi64(hi, 32));
+    __m128i sum = _mm_unpacklo_epi64(
+        _mm_shuffle_epi32(lo, _MM_SHUFFLE(3, 1, 2, 0)),
+        _mm_shuffle_epi32(hi, _MM_SHUFFLE(3, 1, 2, 0)));
+    return _mm_srli_epi32(_mm_add_epi32(sum, _mm_set1_epi32(128)), 8);
+}
+
+static int rows_sse2(const guint8 *src, int src_channels,
+                     guint8 *dst, int dst_channels,
+                     int width, const guint8 *lut) {
+    int stop = block_stop(src_channels, width);
+    int x = 0;
+
+    for (; x + 16 <= stop; x += 16) {
+        const guint8 *s = src + x * src_channels;
+        __m128i y[4];
+        for (int i = 0; i < 4; i++)
+            y[i] = sse2_luma4(sse2_load4(s + i * 4 * src_channels,
+                                         src_channels));
+        __m128i gray = _mm_packus_epi16(_mm_packs_epi32(y[0], y[1]),
+                                        _mm_packs_epi32(y[2], y[3]));
+
+        if (dst_channels == 1 && !lut) {
+            _mm_storeu_si128((__m128i *)(dst + x), gray);
+        } else {
+            guint8 t[16];
+            _mm_storeu_si128((__m128i *)t, gray);
+            block_store(src, src_channels, dst, dst_channels, x, t, lut);
+        }
+    }
+    return x;
+}
+
+/* Eight pixels as 32-bit lanes, in order */
+__attribute__((target("avx2")))
+static inline __m256i avx2_load8(const guint8 *s, int src_channels) {
+    if (src_channels == 4)
+        return _mm256_loadu_si256((const __m256i *)s);
+    /* Four pixels in each 128-bit lane, spread out to four bytes */
+    const __m256i spread = _mm256_setr_epi8(
+        0, 1, 2, -1, 3, 4, 5, -1, 6, 7, 8, -1, 9, 10, 11, -1,
+        0, 1, 2, -1, 3, 4, 5, -1, 6, 7, 8, -1, 9, 10, 11, -1);
+    __m256i px = _mm256_inserti128_si256(
+        _mm256_castsi128_si256(_mm_loadu_si128((const __m128i *)s)),
+        _mm_loadu_si128((const __m128i *)(s + 12)), 1);
+    return _mm256_shuffle_epi8(px, spread);
+}
+
+/* Luminance of eight pixels, as 32-bit lanes in order */
+__attribute__((target("avx2")))
+static inline __m256i avx2_luma8(__m256i px) {
+    const __m256i zero = _mm256_setzero_si256();
+    const __m256i w = _mm256_set1_epi64x(GRAY_WEIGHTS);
+    /* Unpacking works within 128-bit lanes, and so does hadd, which
+     * puts pixels 0-3 back in the low lane and 4-7 in the high one */
+    __m256i lo = _mm256_madd_epi16(_mm256_unpacklo_epi8(px, zero), w);
+    __m256i hi = _mm256_madd_epi16(_mm256_unpackhi_epi8(px, zero), w);
+    __m256i sum = _mm256_hadd_epi32(lo, hi);
+    return _mm256_srli_epi32(_mm256_add_epi32(sum, _mm256_set1_epi32(128)), 8);
+}
+
+__attribute__((target("avx2")))
+static int rows_avx2(const guint8 *src, int src_channels,
+                     guint8 *dst, int dst_channels,
+                     int width, const guint8 *lut) {
+    int stop = block_stop(src_channels, width);
+    int x = 0;
+
+    for (; x + 16 <= stop; x += 16) {
+        const guint8 *s = src + x * src_channels;
+        __m256i a = avx2_luma8(avx2_load8(s, src_channels));
+        __m256i b = avx2_luma8(avx2_load8(s + 8 * src_channels,
+                                          src_channels));
+        /* packs interleaves the lanes: 0-3 8-11 | 4-7 12-15 */
+        __m256i words = _mm256_permute4x64_epi64(_mm256_packs_epi32(a, b),
+                                                 _MM_SHUFFLE(3, 1, 2, 0));
+        __m128i gray = _mm_packus_epi16(_mm256_castsi256_si128(words),
+                                        _mm256_extracti128_si256(words, 1));
+
+        if (dst_channels == 1 && !lut) {
+            _mm_storeu_si128((__m128i *)(dst + x), gray);
+        } else {
+            guint8 t[16];
+            _mm_storeu_si128((__m128i *)t, gray);
+            block_store(src, src_channels, dst, dst_channels, x, t, lut);
+        }
+    }
+    return x;
+}
+
+#undef GRAY_WEIGHTS
+
+#endif
+
+/* ── Dispatch ──────────────────────────────────────────────────────── */
+
+static const char *const kernel_names[] = {
+    "default", "sse2", "avx2", "neon"
+};
+
+static Kernel best_kernel(void) {
+#if defined(GRAY_NEON)
+    return KERNEL_NEON;
+#elif defined(GRAY_X86)
+    return __builtin_cpu_supports("avx2") ? KERNEL_AVX2 : KERNEL_SSE2;
+#else
+    return KERNEL_DEFAULT;
+#endif
+}
+
+static void run_kernel(Kernel kernel, const guint8 *src, int src_channels,
+                       guint8 *dst, int dst_channels,
+                       int width, const guint8 *lut) {
+    g_return_if_fail(src_channels == 3 || src_channels == 4);
+    g_return_if_fail(dst_channels == 1 || dst_channels == 3 ||
+                     dst_channels == 4);
+
+    int from = 0;
+#ifdef GRAY_NEON
+    if (kernel == KERNEL_NEON)
+        from = rows_neon(src, src_channels, dst, dst_channels, width, lut);
+#endif
+#ifdef GRAY_X86
+    if (kernel == KERNEL_SSE2)
+        from = rows_sse2(src, src_channels, dst, dst_channels, width, lut);
+    else if (kernel == KERNEL_AVX2)
+        from = rows_avx2(src, src_channels, dst, dst_channels, width, lut);
+#endif
+    rows_scalar(src, src_channels, dst, dst_channels, from, width, lut);
+}
+
+/* ── Public API ────────────────────────────────────────────────────── */
+
+void grayscale_row(const guint8 *src, int src_channels,
+                   guint8 *dst, int dst_channels,
+                   int width, const guint8 *lut) {
+    run_kernel(best_kernel(), src, src_channels, dst, dst_channels,
+               width, lut);
+}
+
+const char *const *grayscale_kernels(void) {
+    static const char *list[G_N_ELEMENTS(kernel_names) + 1];
+    static gsize ready = 0;
+
+    if (g_once_init_enter(&ready)) {
+        /* Fastest first, the one grayscale_row uses */
+        int n = 0;
+        Kernel best = best_kernel();
+        list[n++] = kernel_names[best];
+        if (best == KERNEL_AVX2)
+            list[n++] = kernel_names[KERNEL_SSE2];
+        if (best != KERNEL_DEFAULT)
+            list[n++] = kernel_names[KERNEL_DEFAULT];
+        list[n] = NULL;
+        g_once_init_leave(&ready, 1);
+    }
+    return list;
+}
+
+void grayscale_row_kernel(const char *kernel, const guint8 *src,
+                          int src_channels, guint8 *dst, int dst_channels,
+                          int width, const guint8 *lut) {
+    for (guint k = 0; k < G_N_ELEMENTS(kernel_names); k++) {
+        if (strcmp(kernel, kernel_names[k]) == 0) {
+            run_kernel((Kernel)k, src, src_channels, dst, dst_channels,
+                       width, lut);
+            return;
+        }
+    }
+    g_return_if_reached();
+}
+
+void grayscale_tone_lut(guint8 lut[256], double gamma, double contrast) {
+    if (gamma <= 0) gamma = 1.0;
+    for (int i = 0; i < 256; i++) {
+        double v = (i / 255.0 - 0.5) * contrast + 0.5;
+        v = CLAMP(v, 0.0, 1.0);
+        v = pow(v, gamma);
+        lut[i] = (guint8)(v * 255.0 + 0.5);
+    }
+}
+
+/* ── Gray images ───────────────────────────────────────────────────── */
+
+GrayImage *gray_image_new(int width, int height) {
+    g_return_val_if_fail(width > 0 && height > 0, NULL);
+    /* Rows padded to four bytes, like pixbufs, in one block with the header */
+    int rowstride = (width + 3) & ~3;
+    GrayImage *image = g_try_malloc(sizeof(GrayImage) +
+                                    (gsize)rowstride * height);
+    if (!image) return NULL;
+    image->width = width;
+    image->height = height;
+    image->rowstride = rowstride;
+    image->pixels = (guint8 *)(image + 1);
+    image->ref_count = 1;
+    return image;
+}
+
+GrayImage *gray_image_ref(GrayImage *image) {
+    g_atomic_int_inc(&image->ref_count);
+    return image;
+}
+
+void gray_image_unref(GrayImage *image) {
+    if (image && g_atomic_int_dec_and_test(&image->ref_count))
+        g_free(image);
+}
+
+GrayImage *gray_image_rotate(const GrayImage *image, int degrees) {
+    g_return_val_if_fail(degrees == 90 || degrees == 180 || degrees == 270,
+                         NULL);
+    int w = image->width, h = image->height;
+    GrayImage *dest = degrees == 180 ? gray_image_new(w, h)
+                                     : gray_image_new(h, w);
+    if (!dest) return NULL;
+
+    for (int y = 0; y < dest->height; y++) {
+        guint8 *d = dest->pixels + y * dest->rowstride;
+        for (int x = 0; x < dest->width; x++) {
+            int sx, sy;
+            switch (degrees) {
+            case 90:  sx = w - 1 - y; sy = x;         break;
+            case 180: sx = w - 1 - x; sy = h - 1 - y; break;
+            default:  sx = y;         sy = h - 1 - x; break;
+            }
+            d[x] = image->pixels[sy * image->rowstride + sx];
+        }
+    }
+    return dest;
+}
+
+gsize gray_image_size(const GrayImage *image) {
+    return sizeof(GrayImage) + (gsize)image->rowstride * image->height;
+}
@@ -0,0 +1,52 @@
+#ifndef GRAYSCALE_H
+#define GRAYSCALE_H
+
+#include <glib.h>
+
+/* Luminance of a row of 8-bit RGB or RGBA pixels, using BT.601 weights in
+ * fixed point. src_channels is 3 or 4; dst_channels is 1 (gray), 3 (gray
+ * in R, G and B) or 4 (the same plus alpha, copied from src or opaque).
+ * If lut is not NULL, each gray value y is written as lut[y]. On x86-64
+ * the AVX2 kernel is used if the CPU has AVX2, the SSE2 one if not; ARM
+ * builds always use the NEON kernel, which is chosen at compile time. */
+void grayscale_row(const guint8 *src, int src_channels,
+                   guint8 *dst, int dst_channels,
+                   int width, const guint8 *lut);
+
+/* The kernels this build can run on this CPU, by name ("neon", "avx2",
+ * "sse2", "default"), fastest first and NULL-terminated; grayscale_row uses the
+ * first. For checking them against each other. */
+const char *const *grayscale_kernels(void);
+
+/* grayscale_row with a named kernel from grayscale_kernels */
+void grayscale_row_kernel(const char *kernel, const guint8 *src,
+                          int src_channels, guint8 *dst, int dst_channels,
+                          int width, const guint8 *lut);
+
+/* Fill lut with a tone curve for grayscale_row: contrast stretches values
+ * around mid-gray (1.0 leaves them alone), then gamma > 1.0 darkens the
+ * mid-tones and < 1.0 lightens them. */
+void grayscale_tone_lut(guint8 lut[256], double gamma, double contrast);
+
+/* An 8-bit single-channel image: a third of the memory of an RGB pixbuf
+ * with R = G = B. Reference counted; the count is thread-safe. */
+typedef struct {
+    int     width;
+    int     height;
+    int     rowstride;
+    guint8 *pixels;
+    gint    ref_count;
+} GrayImage;
+
+GrayImage *gray_image_new(int width, int height);
+GrayImage *gray_image_ref(GrayImage *image);
+void       gray_image_unref(GrayImage *image);
+
+/* A rotated copy; degrees is counterclockwise, as for GdkPixbufRotation,
+ * and must be 90, 180 or 270. */
+GrayImage *gray_image_rotate(const GrayImage *image, int degrees);
+
+/* Bytes held by the image, for memory budgets */
+gsize      gray_image_size(const GrayImage *image);
+
+#endif /* GRAYSCALE_H */